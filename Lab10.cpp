@@ -5,8 +5,34 @@
 #include <fstream>
 #include <algorithm>
 #include <stdexcept>
+#include <string_view>
+#include <charconv>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <optional>
+#include <bit>
+#include <numeric>
+#include <filesystem>
+#include <unordered_map>
+#include <type_traits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block_codec.h"
+#endif
 
 // ------------------------ User Base Class ------------------------
+// Тип пользователя; он же метка в колонке типов снимка
+enum class UserKind : uint8_t { User, Student, Teacher, Administrator };
+
 class User {
 protected:
     std::string name;
@@ -17,22 +43,34 @@ public:
     User(std::string name, int id, int accessLevel) {
         if (name.empty()) throw std::invalid_argument("Имя не может быть пустым.");
         if (accessLevel < 0) throw std::invalid_argument("Уровень доступа не может быть отрицательным.");
-        this->name = name;
+        this->name = std::move(name);
         this->id = id;
         this->accessLevel = accessLevel;
     }
 
     virtual ~User() = default;
 
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
     int getId() const { return id; }
     int getAccessLevel() const { return accessLevel; }
 
+    virtual UserKind getKind() const { return UserKind::User; }
+
+    // Поле производного типа: группа, кафедра или роль
+    virtual std::string_view getDetail() const { return {}; }
+
     virtual void displayInfo() const {
         std::cout << "Имя: " << name << ", ID: " << id << ", Уровень доступа: " << accessLevel << "\n";
     }
 
+    // Строка для saveUsersToFile: тип, затем поля (см. parseUser)
     virtual std::string serialize() const {
+        return "User," + serializeFields();
+    }
+
+protected:
+    // Общие поля всех типов: имя,id,уровень
+    std::string serializeFields() const {
         return name + "," + std::to_string(id) + "," + std::to_string(accessLevel);
     }
 };
@@ -42,7 +80,10 @@ class Student : public User {
     std::string group;
 public:
     Student(std::string name, int id, int accessLevel, std::string group)
-        : User(name, id, accessLevel), group(group) {}
+        : User(std::move(name), id, accessLevel), group(std::move(group)) {}
+
+    UserKind getKind() const override { return UserKind::Student; }
+    std::string_view getDetail() const override { return group; }
 
     void displayInfo() const override {
         User::displayInfo();
@@ -50,7 +91,7 @@ public:
     }
 
     std::string serialize() const override {
-        return "Student," + User::serialize() + "," + group;
+        return "Student," + serializeFields() + "," + group;
     }
 };
 
@@ -58,7 +99,10 @@ class Teacher : public User {
     std::string department;
 public:
     Teacher(std::string name, int id, int accessLevel, std::string department)
-        : User(name, id, accessLevel), department(department) {}
+        : User(std::move(name), id, accessLevel), department(std::move(department)) {}
+
+    UserKind getKind() const override { return UserKind::Teacher; }
+    std::string_view getDetail() const override { return department; }
 
     void displayInfo() const override {
         User::displayInfo();
@@ -66,7 +110,7 @@ public:
     }
 
     std::string serialize() const override {
-        return "Teacher," + User::serialize() + "," + department;
+        return "Teacher," + serializeFields() + "," + department;
     }
 };
 
@@ -74,7 +118,10 @@ class Administrator : public User {
     std::string role;
 public:
     Administrator(std::string name, int id, int accessLevel, std::string role)
-        : User(name, id, accessLevel), role(role) {}
+        : User(std::move(name), id, accessLevel), role(std::move(role)) {}
+
+    UserKind getKind() const override { return UserKind::Administrator; }
+    std::string_view getDetail() const override { return role; }
 
     void displayInfo() const override {
         User::displayInfo();
@@ -82,10 +129,71 @@ public:
     }
 
     std::string serialize() const override {
-        return "Administrator," + User::serialize() + "," + role;
+        return "Administrator," + serializeFields() + "," + role;
     }
 };
 
+// ------------------------ Parsing ------------------------
+// Следующее поле до запятой; line сдвигается за разделитель
+inline std::string_view nextField(std::string_view& line) {
+    size_t delim = line.find(',');
+    std::string_view field = line.substr(0, delim);
+    line.remove_prefix(delim == std::string_view::npos ? line.size() : delim + 1);
+    return field;
+}
+
+inline int parseInt(std::string_view field) {
+    int value = 0;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (error != std::errc() || end != field.data() + field.size())
+        throw std::invalid_argument("Неверное число: " + std::string(field));
+    return value;
+}
+
+std::shared_ptr<User> makeUser(UserKind kind, std::string name, int id, int accessLevel, std::string detail) {
+    switch (kind) {
+        case UserKind::Student:
+            return std::make_shared<Student>(std::move(name), id, accessLevel, std::move(detail));
+        case UserKind::Teacher:
+            return std::make_shared<Teacher>(std::move(name), id, accessLevel, std::move(detail));
+        case UserKind::Administrator:
+            return std::make_shared<Administrator>(std::move(name), id, accessLevel, std::move(detail));
+        case UserKind::User:
+            break;
+    }
+    return std::make_shared<User>(std::move(name), id, accessLevel);
+}
+
+// Пользователь из строки формата serialize(): Тип,имя,id,уровень[,доп. поле].
+// Доп. поле есть у всех типов, кроме простого User
+std::shared_ptr<User> parseUser(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    bool more = true;   // в строке остались поля
+    auto field = [&]() {
+        if (!more) throw std::invalid_argument("Слишком мало полей в строке пользователя");
+        more = line.find(',') != std::string_view::npos;
+        return nextField(line);
+    };
+    std::string_view type = field();
+    std::string name(field());
+    int id = parseInt(field());
+    int accessLevel = parseInt(field());
+
+    UserKind kind;
+    if (type == "User") kind = UserKind::User;
+    else if (type == "Student") kind = UserKind::Student;
+    else if (type == "Teacher") kind = UserKind::Teacher;
+    else if (type == "Administrator") kind = UserKind::Administrator;
+    else throw std::invalid_argument("Неизвестный тип пользователя: " + std::string(type));
+
+    if (kind == UserKind::User) {
+        if (more) throw std::invalid_argument("Лишние поля в строке пользователя");
+        return makeUser(kind, std::move(name), id, accessLevel, {});
+    }
+    if (!more) throw std::invalid_argument("Слишком мало полей в строке пользователя");
+    return makeUser(kind, std::move(name), id, accessLevel, std::string(line));   // остаток строки целиком
+}
+
 // ------------------------ Resource Class ------------------------
 class Resource {
     std::string name;
@@ -94,6 +202,9 @@ public:
     Resource(std::string name, int requiredAccessLevel)
         : name(name), requiredAccessLevel(requiredAccessLevel) {}
 
+    const std::string& getName() const { return name; }
+    int getRequiredAccessLevel() const { return requiredAccessLevel; }
+
     bool checkAccess(const User& user) const {
         return user.getAccessLevel() >= requiredAccessLevel;
     }
@@ -107,8 +218,498 @@ public:
     }
 
     static Resource deserialize(const std::string& line) {
-        size_t delim = line.find(',');
-        return Resource(line.substr(0, delim), std::stoi(line.substr(delim + 1)));
+        std::string_view rest = line;
+        if (!rest.empty() && rest.back() == '\r') rest.remove_suffix(1);
+        std::string_view name = nextField(rest);
+        return Resource(std::string(name), parseInt(rest));
+    }
+};
+
+// ------------------------ Compressed User File ------------------------
+// Сжатый файл пользователей: "L10Z", u32 версия, затем кадры блочного
+// сжатия. В кадре до kUsersPerBlock пользователей: varint их число, словарь
+// доп. полей (varint число строк, у каждой varint длина и байты), затем
+// записи - u8 тип, varint длина имени, имя, zigzag-varint разность id с
+// предыдущим, varint уровень, varint номер доп. поля в словаре.
+// Кадры независимы, поэтому читаются параллельно, как куски текста.
+enum class UserFileFormat { Text, Compressed };
+
+constexpr char kUserFileMagic[4] = {'L', '1', '0', 'Z'};
+constexpr uint32_t kUserFileVersion = 1;
+constexpr size_t kUserFileHeaderBytes = 8;
+constexpr size_t kUsersPerBlock = 32768;
+
+template<typename U>
+std::string encodeUserBlock(const std::shared_ptr<U>* users, size_t count) {
+    std::vector<std::string_view> dictionary;
+    std::unordered_map<std::string_view, uint64_t> codes;
+    std::string records;
+    int64_t previousId = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const User& user = *users[i];
+        auto [it, added] = codes.try_emplace(user.getDetail(), dictionary.size());
+        if (added) dictionary.push_back(user.getDetail());
+        records += static_cast<char>(user.getKind());
+        appendVarint(records, user.getName().size());
+        records += user.getName();
+        appendVarint(records, zigzag(static_cast<int64_t>(user.getId()) - previousId));
+        appendVarint(records, static_cast<uint64_t>(user.getAccessLevel()));
+        appendVarint(records, it->second);
+        previousId = user.getId();
+    }
+
+    std::string block;
+    appendVarint(block, count);
+    appendVarint(block, dictionary.size());
+    for (std::string_view text : dictionary) {
+        appendVarint(block, text.size());
+        block += text;
+    }
+    block += records;
+    return block;
+}
+
+void decodeUserBlock(std::string_view block, std::vector<std::shared_ptr<User>>& out) {
+    const char* p = block.data();
+    const char* end = p + block.size();
+    auto corrupt = [] { return std::runtime_error("Файл пользователей повреждён."); };
+    auto number = [&] {
+        uint64_t value = 0;
+        if (!readVarint(p, end, value)) throw corrupt();
+        return value;
+    };
+    auto text = [&] {
+        uint64_t length = number();
+        if (length > static_cast<uint64_t>(end - p)) throw corrupt();
+        std::string_view value(p, length);
+        p += length;
+        return value;
+    };
+
+    uint64_t count = number();
+    uint64_t words = number();
+    if (count > block.size() || words > block.size()) throw corrupt();
+    std::vector<std::string_view> dictionary(words);
+    for (auto& word : dictionary) word = text();
+
+    out.reserve(out.size() + count);
+    int64_t id = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (p == end) throw corrupt();
+        uint8_t kind = static_cast<uint8_t>(*p++);
+        if (kind > static_cast<uint8_t>(UserKind::Administrator)) throw corrupt();
+        std::string_view name = text();
+        id += unzigzag(number());
+        uint64_t accessLevel = number();
+        uint64_t detail = number();
+        if (detail >= dictionary.size() || accessLevel > INT32_MAX || id < INT32_MIN || id > INT32_MAX) throw corrupt();
+        out.push_back(makeUser(UserKind(kind), std::string(name), static_cast<int>(id), static_cast<int>(accessLevel),
+                               std::string(dictionary[detail])));
+    }
+    if (p != end) throw corrupt();
+}
+
+template<typename U>
+void writeCompressedUsers(const std::string& filename, const std::vector<std::shared_ptr<U>>& users) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) throw std::runtime_error("Не удалось записать файл " + filename);
+    std::string out(kUserFileMagic, 4);
+    out.append(reinterpret_cast<const char*>(&kUserFileVersion), 4);
+    for (size_t first = 0; first < users.size(); first += kUsersPerBlock) {
+        size_t count = std::min(kUsersPerBlock, users.size() - first);
+        appendFrame(out, encodeUserBlock(users.data() + first, count));
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        out.clear();
+    }
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file) throw std::runtime_error("Не удалось записать файл " + filename);
+}
+
+bool isCompressedUserFile(std::ifstream& file, size_t size) {
+    char header[kUserFileHeaderBytes];
+    if (size < kUserFileHeaderBytes) return false;
+    file.seekg(0);
+    file.read(header, sizeof(header));
+    return std::memcmp(header, kUserFileMagic, 4) == 0;
+}
+
+// Границы кадров сжатого файла: читаются только их заголовки
+std::vector<size_t> compressedUserChunks(std::ifstream& file, size_t size) {
+    uint32_t version = 0;
+    file.seekg(4);
+    file.read(reinterpret_cast<char*>(&version), 4);
+    if (version != kUserFileVersion) throw std::runtime_error("Неизвестная версия файла пользователей.");
+
+    std::vector<size_t> bounds{kUserFileHeaderBytes};
+    char header[20];
+    while (bounds.back() < size) {
+        size_t at = bounds.back();
+        size_t want = std::min(sizeof(header), size - at);
+        file.seekg(static_cast<std::streamoff>(at));
+        file.read(header, static_cast<std::streamsize>(want));
+        const char* p = header;
+        uint64_t rawSize = 0;
+        uint64_t packedSize = 0;
+        if (!readVarint(p, header + want, rawSize) || !readVarint(p, header + want, packedSize) ||
+            packedSize > size - at - static_cast<size_t>(p - header))
+            throw std::runtime_error("Файл пользователей повреждён.");
+        bounds.push_back(at + static_cast<size_t>(p - header) + packedSize);
+    }
+    return bounds;
+}
+
+// ------------------------ Bulk Import ------------------------
+constexpr size_t kImportChunkBytes = 32 << 20;
+
+// Границы кусков файла: каждая сдвинута к началу строки, так что строка
+// целиком попадает в один кусок
+std::vector<size_t> lineAlignedChunks(std::ifstream& file, size_t size) {
+    std::vector<size_t> bounds{0};
+    char probe[4096];
+    for (size_t at = kImportChunkBytes; at < size; at += kImportChunkBytes) {
+        size_t pos = std::max(at, bounds.back());
+        file.seekg(static_cast<std::streamoff>(pos));
+        size_t lineEnd = size;
+        while (pos < size) {
+            size_t want = std::min(sizeof(probe), size - pos);
+            file.read(probe, static_cast<std::streamsize>(want));
+            const void* newline = std::memchr(probe, '\n', want);
+            if (newline) {
+                lineEnd = pos + static_cast<size_t>(static_cast<const char*>(newline) - probe) + 1;
+                break;
+            }
+            pos += want;
+        }
+        if (lineEnd >= size) break;
+        bounds.push_back(lineEnd);
+        at = lineEnd;
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+// Читает файл формата saveUsersToFile (текстовый или сжатый): куски
+// разбираются параллельно (string_view и from_chars, без временных строк
+// на каждое поле), объекты строятся в своём куске, потом всё сливается в
+// порядке файла. Объекты строит makeUser по виду из файла, поэтому
+// результат - всегда указатели на User.
+std::vector<std::shared_ptr<User>> importUsers(const std::string& filename, unsigned threads) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Не удалось открыть файл " + filename);
+    size_t size = static_cast<size_t>(file.tellg());
+    bool compressed = isCompressedUserFile(file, size);
+    std::vector<size_t> bounds = compressed ? compressedUserChunks(file, size) : lineAlignedChunks(file, size);
+    size_t chunkCount = bounds.size() - 1;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, chunkCount)));
+
+    std::vector<std::vector<std::shared_ptr<User>>> parsed(chunkCount);
+    std::vector<std::exception_ptr> errors(chunkCount);
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<bool> failed{false};
+
+    auto parseChunks = [&] {
+        std::ifstream in(filename, std::ios::binary);
+        std::string buffer;
+        std::string block;
+        for (size_t c = nextChunk++; c < chunkCount && !failed; c = nextChunk++) {
+            try {
+                buffer.resize(bounds[c + 1] - bounds[c]);
+                in.seekg(static_cast<std::streamoff>(bounds[c]));
+                if (!in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+                    throw std::runtime_error("Ошибка чтения файла " + filename);
+                auto& out = parsed[c];
+                if (compressed) {
+                    const char* p = buffer.data();
+                    block.clear();
+                    if (!readFrame(p, p + buffer.size(), block) || p != buffer.data() + buffer.size())
+                        throw std::runtime_error("Файл пользователей повреждён.");
+                    decodeUserBlock(block, out);
+                    continue;
+                }
+                out.reserve(buffer.size() / 32);
+                std::string_view rest = buffer;
+                while (!rest.empty()) {
+                    size_t newline = rest.find('\n');
+                    std::string_view line = rest.substr(0, newline);
+                    rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+                    if (!line.empty() && line != "\r") out.push_back(parseUser(line));
+                }
+            } catch (...) {
+                errors[c] = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+    auto runPool = [threads](auto& work) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+        work();
+        for (auto& th : pool) th.join();
+    };
+    runPool(parseChunks);
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Слияние: каждый кусок переносится на своё место тоже параллельно
+    std::vector<size_t> offsets(chunkCount + 1, 0);
+    for (size_t c = 0; c < chunkCount; ++c) offsets[c + 1] = offsets[c] + parsed[c].size();
+    std::vector<std::shared_ptr<User>> users(offsets.back());
+    nextChunk = 0;
+    auto mergeChunks = [&] {
+        for (size_t c = nextChunk++; c < chunkCount; c = nextChunk++) {
+            std::move(parsed[c].begin(), parsed[c].end(), users.begin() + static_cast<std::ptrdiff_t>(offsets[c]));
+            std::vector<std::shared_ptr<User>>().swap(parsed[c]);
+        }
+    };
+    runPool(mergeChunks);
+    return users;
+}
+
+// ------------------------ Columnar Snapshot ------------------------
+// Снимок каталога для быстрого перезапуска: файл отображается в память и
+// читается на месте, без разбора. Числа в порядке байт узла (little-endian),
+// каждая колонка выровнена на 8 байт:
+//   заголовок: "L10S", u32 версия, u64 пользователей n, u64 ресурсов m,
+//              u64 байт в куче строк, u64 размер файла, u64 резерв
+//   i32 id[n], i32 уровень[n], u8 тип (UserKind)[n],
+//   u64 начало имени[n+1], u64 начало доп. поля[n+1] (смещения в куче),
+//   u32 номера пользователей по возрастанию id[n],
+//   i32 уровень ресурса[m], u64 начало имени ресурса[m+1], куча строк
+static_assert(std::endian::native == std::endian::little, "Снимок хранит числа в little-endian");
+
+constexpr char kSnapshotMagic[4] = {'L', '1', '0', 'S'};
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint64_t kSnapshotHeaderBytes = 48;
+
+struct SnapshotLayout {
+    uint64_t ids = 0, levels = 0, kinds = 0, nameStarts = 0, detailStarts = 0, byId = 0;
+    uint64_t resourceLevels = 0, resourceNameStarts = 0, heap = 0, total = 0;
+
+    SnapshotLayout() = default;
+    SnapshotLayout(uint64_t users, uint64_t resources, uint64_t heapBytes) {
+        uint64_t at = kSnapshotHeaderBytes;
+        auto column = [&at](uint64_t bytes) {
+            uint64_t start = at;
+            at = (at + bytes + 7) & ~uint64_t(7);
+            return start;
+        };
+        ids = column(users * 4);
+        levels = column(users * 4);
+        kinds = column(users);
+        nameStarts = column((users + 1) * 8);
+        detailStarts = column((users + 1) * 8);
+        byId = column(users * 4);
+        resourceLevels = column(resources * 4);
+        resourceNameStarts = column((resources + 1) * 8);
+        heap = at;
+        total = at + heapBytes;
+    }
+};
+
+template<typename U, typename R>
+void writeDirectorySnapshot(const std::string& filename, const std::vector<std::shared_ptr<U>>& users,
+                            const std::vector<R>& resources) {
+    if (users.size() > UINT32_MAX) throw std::runtime_error("Слишком много пользователей для снимка.");
+    size_t n = users.size();
+    size_t m = resources.size();
+
+    std::vector<int32_t> ids(n), levels(n), resourceLevels(m);
+    std::vector<uint8_t> kinds(n);
+    std::vector<uint64_t> nameStarts(n + 1), detailStarts(n + 1), resourceNameStarts(m + 1);
+    std::string heap;
+    for (size_t i = 0; i < n; ++i) {
+        ids[i] = users[i]->getId();
+        levels[i] = users[i]->getAccessLevel();
+        kinds[i] = static_cast<uint8_t>(users[i]->getKind());
+        nameStarts[i] = heap.size();
+        heap += users[i]->getName();
+    }
+    nameStarts[n] = heap.size();
+    for (size_t i = 0; i < n; ++i) {
+        detailStarts[i] = heap.size();
+        heap += users[i]->getDetail();
+    }
+    detailStarts[n] = heap.size();
+    for (size_t j = 0; j < m; ++j) {
+        resourceLevels[j] = resources[j].getRequiredAccessLevel();
+        resourceNameStarts[j] = heap.size();
+        heap += resources[j].getName();
+    }
+    resourceNameStarts[m] = heap.size();
+    std::vector<uint32_t> byId(n);
+    std::iota(byId.begin(), byId.end(), 0u);
+    std::stable_sort(byId.begin(), byId.end(), [&ids](uint32_t a, uint32_t b) { return ids[a] < ids[b]; });
+
+    SnapshotLayout layout(n, m, heap.size());
+    char header[kSnapshotHeaderBytes] = {};
+    uint64_t counts[4] = {n, m, heap.size(), layout.total};
+    std::memcpy(header, kSnapshotMagic, 4);
+    std::memcpy(header + 4, &kSnapshotVersion, 4);
+    std::memcpy(header + 8, counts, sizeof(counts));
+
+    // Пишем во временный файл и подменяем: читатели старого снимка его дочитают
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Не удалось записать снимок " + filename);
+        uint64_t written = 0;
+        auto column = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char padding[8] = {};
+            out.write(padding, static_cast<std::streamsize>(offset - written));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            written = offset + bytes;
+        };
+        column(0, header, sizeof(header));
+        column(layout.ids, ids.data(), n * 4);
+        column(layout.levels, levels.data(), n * 4);
+        column(layout.kinds, kinds.data(), n);
+        column(layout.nameStarts, nameStarts.data(), (n + 1) * 8);
+        column(layout.detailStarts, detailStarts.data(), (n + 1) * 8);
+        column(layout.byId, byId.data(), n * 4);
+        column(layout.resourceLevels, resourceLevels.data(), m * 4);
+        column(layout.resourceNameStarts, resourceNameStarts.data(), (m + 1) * 8);
+        column(layout.heap, heap.data(), heap.size());
+        if (!out) throw std::runtime_error("Не удалось записать снимок " + filename);
+    }
+    std::filesystem::rename(temporary, filename);
+}
+
+// Снимок, открытый только для чтения. Отображение общее (MAP_SHARED), так
+// что все процессы, открывшие один файл, читают одну копию в page cache
+class DirectorySnapshot {
+    const char* bytes = nullptr;
+    size_t length = 0;
+    std::string contents;
+#ifndef _WIN32
+    void* mapping = nullptr;
+#endif
+    uint64_t users = 0;
+    uint64_t resources = 0;
+    uint64_t heapBytes = 0;
+    SnapshotLayout layout;
+
+    template<typename T>
+    T column(uint64_t offset, size_t index) const {
+        T value;
+        std::memcpy(&value, bytes + offset + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    std::string_view heapString(uint64_t starts, size_t index) const {
+        uint64_t begin = column<uint64_t>(starts, index);
+        uint64_t end = column<uint64_t>(starts, index + 1);
+        if (begin > end || end > heapBytes) throw std::runtime_error("Снимок повреждён.");
+        return std::string_view(bytes + layout.heap + begin, end - begin);
+    }
+
+    void release() {
+#ifndef _WIN32
+        if (mapping) munmap(mapping, length);
+        mapping = nullptr;
+#endif
+        bytes = nullptr;
+    }
+
+    void checkUser(size_t user) const {
+        if (user >= users) throw std::out_of_range("Нет пользователя с таким номером.");
+    }
+
+public:
+    // Проверяется только заголовок: данные читаются по мере запросов
+    explicit DirectorySnapshot(const std::string& filename) {
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Не удалось открыть снимок " + filename);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Не удалось открыть снимок " + filename);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length >= kSnapshotHeaderBytes) {
+            mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) mapping = nullptr;
+        }
+        ::close(fd);
+        bytes = static_cast<const char*>(mapping);
+#else
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) throw std::runtime_error("Не удалось открыть снимок " + filename);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = contents.data();
+        length = contents.size();
+#endif
+        if (!bytes || length < kSnapshotHeaderBytes || std::memcmp(bytes, kSnapshotMagic, 4) != 0 ||
+            column<uint32_t>(4, 0) != kSnapshotVersion) {
+            release();
+            throw std::runtime_error("Файл " + filename + " не является снимком каталога.");
+        }
+        users = column<uint64_t>(8, 0);
+        resources = column<uint64_t>(16, 0);
+        heapBytes = column<uint64_t>(24, 0);
+        // Счётчики не больше размера файла, иначе размеры колонок могли бы переполниться
+        bool sane = users <= length && resources <= length && heapBytes <= length;
+        if (sane) layout = SnapshotLayout(users, resources, heapBytes);
+        if (!sane || layout.total != length || column<uint64_t>(32, 0) != length) {
+            release();
+            throw std::runtime_error("Снимок повреждён.");
+        }
+    }
+
+    ~DirectorySnapshot() {
+        release();
+    }
+
+    DirectorySnapshot(const DirectorySnapshot&) = delete;
+    DirectorySnapshot& operator=(const DirectorySnapshot&) = delete;
+
+    size_t userCount() const { return users; }
+    size_t resourceCount() const { return resources; }
+
+    int getId(size_t user) const { checkUser(user); return column<int32_t>(layout.ids, user); }
+    int getAccessLevel(size_t user) const { checkUser(user); return column<int32_t>(layout.levels, user); }
+    UserKind getKind(size_t user) const { checkUser(user); return UserKind(column<uint8_t>(layout.kinds, user)); }
+    std::string_view getName(size_t user) const { checkUser(user); return heapString(layout.nameStarts, user); }
+    std::string_view getDetail(size_t user) const { checkUser(user); return heapString(layout.detailStarts, user); }
+
+    std::string_view getResourceName(size_t resource) const {
+        if (resource >= resources) throw std::out_of_range("Нет ресурса с таким номером.");
+        return heapString(layout.resourceNameStarts, resource);
+    }
+
+    int getRequiredAccessLevel(size_t resource) const {
+        if (resource >= resources) throw std::out_of_range("Нет ресурса с таким номером.");
+        return column<int32_t>(layout.resourceLevels, resource);
+    }
+
+    bool checkAccess(size_t user, size_t resource) const {
+        return getAccessLevel(user) >= getRequiredAccessLevel(resource);
+    }
+
+    // Двоичный поиск по колонке номеров, отсортированных по id
+    std::optional<size_t> findById(int id) const {
+        size_t low = 0, high = users;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            uint32_t user = column<uint32_t>(layout.byId, mid);
+            if (user >= users) throw std::runtime_error("Снимок повреждён.");
+            if (column<int32_t>(layout.ids, user) < id) low = mid + 1;
+            else high = mid;
+        }
+        if (low == users) return std::nullopt;
+        uint32_t user = column<uint32_t>(layout.byId, low);
+        if (column<int32_t>(layout.ids, user) != id) return std::nullopt;
+        return user;
+    }
+
+    // Имена лежат в куче подряд, так что перебор идёт по одной области памяти
+    std::optional<size_t> findByName(std::string_view name) const {
+        for (size_t user = 0; user < users; ++user) {
+            if (heapString(layout.nameStarts, user) == name) return user;
+        }
+        return std::nullopt;
     }
 };
 
@@ -138,7 +739,11 @@ public:
         }
     }
 
-    void saveUsersToFile(const std::string& filename) {
+    void saveUsersToFile(const std::string& filename, UserFileFormat format = UserFileFormat::Text) {
+        if (format == UserFileFormat::Compressed) {
+            writeCompressedUsers(filename, users);
+            return;
+        }
         std::ofstream file(filename);
         for (const auto& user : users)
             file << user->serialize() << "\n";
@@ -150,6 +755,38 @@ public:
             file << res.serialize() << "\n";
     }
 
+    void saveSnapshot(const std::string& filename) const {
+        writeDirectorySnapshot(filename, users, resources);
+    }
+
+    // Строит объекты по снимку - для кода, которому нужны именно объекты;
+    // запросы можно делать прямо к DirectorySnapshot
+    void loadSnapshot(const DirectorySnapshot& snapshot) {
+        static_assert(std::is_same_v<U, User>, "Загрузка строит объекты через makeUser, нужен U = User");
+        std::vector<std::shared_ptr<U>> loadedUsers;
+        std::vector<R> loadedResources;
+        loadedUsers.reserve(snapshot.userCount());
+        loadedResources.reserve(snapshot.resourceCount());
+        for (size_t i = 0; i < snapshot.userCount(); ++i) {
+            loadedUsers.push_back(makeUser(snapshot.getKind(i), std::string(snapshot.getName(i)), snapshot.getId(i),
+                                           snapshot.getAccessLevel(i), std::string(snapshot.getDetail(i))));
+        }
+        for (size_t j = 0; j < snapshot.resourceCount(); ++j)
+            loadedResources.emplace_back(std::string(snapshot.getResourceName(j)), snapshot.getRequiredAccessLevel(j));
+        users.swap(loadedUsers);
+        resources.swap(loadedResources);
+    }
+
+    // При ошибке в любой строке текущий список пользователей не меняется
+    void loadUsersFromFile(const std::string& filename, unsigned threads = 0) {
+        static_assert(std::is_same_v<U, User>, "Загрузка строит объекты через makeUser, нужен U = User");
+        users = importUsers(filename, threads);
+    }
+
+    size_t userCount() const {
+        return users.size();
+    }
+
     void loadResourcesFromFile(const std::string& filename) {
         resources.clear();
         std::ifstream file(filename);
@@ -176,8 +813,223 @@ public:
     }
 };
 
+// ------------------------ Benchmark ------------------------
+// Прежний способ для сравнения: getline, substr и std::stoi на каждое поле
+std::vector<std::shared_ptr<User>> legacyLoadUsers(const std::string& filename) {
+    std::vector<std::shared_ptr<User>> users;
+    std::ifstream file(filename);
+    std::string line;
+    while (getline(file, line)) {
+        size_t a = line.find(',');
+        size_t b = line.find(',', a + 1);
+        size_t c = line.find(',', b + 1);
+        size_t d = line.find(',', c + 1);
+        std::string type = line.substr(0, a);
+        std::string name = line.substr(a + 1, b - a - 1);
+        int id = std::stoi(line.substr(b + 1, c - b - 1));
+        int level = std::stoi(line.substr(c + 1, d - c - 1));
+        std::string extra = line.substr(d + 1);
+        if (type == "Student") users.push_back(std::make_shared<Student>(name, id, level, extra));
+        else if (type == "Teacher") users.push_back(std::make_shared<Teacher>(name, id, level, extra));
+        else users.push_back(std::make_shared<Administrator>(name, id, level, extra));
+    }
+    return users;
+}
+
+// Тестовый каталог из count пользователей в формате saveUsersToFile
+void writeBenchUsers(const std::string& path, size_t count) {
+    static const char* const kinds[] = {"Student,", "Teacher,", "Administrator,"};
+    static const char* const extras[] = {"Группа А", "Математика", "ИТ отдел"};
+    std::ofstream out(path, std::ios::binary);
+    std::string block;
+    for (size_t i = 0; i < count; ++i) {
+        size_t kind = i % 10 == 0 ? 1 + i / 10 % 2 : 0;   // в основном студенты
+        block += kinds[kind];
+        block += "user";
+        block += std::to_string(i);
+        block += ',';
+        block += std::to_string(i);
+        block += ',';
+        block += std::to_string(1 + kind * 2);
+        block += ',';
+        block += extras[kind];
+        block += '\n';
+        if (block.size() > (1 << 20)) {
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            block.clear();
+        }
+    }
+    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+}
+
+// Импорт count пользователей из файла (Lab10 --bench-import [n] [потоков])
+void runImportBenchmark(size_t count, unsigned threads) {
+    const std::string path = "users_bench.txt";
+    writeBenchUsers(path, count);
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    size_t legacyCount = 0;
+    double legacy = 0;
+    {
+        auto users = legacyLoadUsers(path);
+        legacy = seconds(start);
+        legacyCount = users.size();
+    }
+
+    double single = 0;
+    {
+        AccessControlSystem<User, Resource> system;
+        start = std::chrono::steady_clock::now();
+        system.loadUsersFromFile(path, 1);
+        single = seconds(start);
+    }
+
+    AccessControlSystem<User, Resource> system;
+    start = std::chrono::steady_clock::now();
+    system.loadUsersFromFile(path, threads);
+    double parallel = seconds(start);
+    std::remove(path.c_str());
+
+    unsigned used = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Пользователей: " << system.userCount() << " (прежним способом " << legacyCount << ")\n";
+    std::cout << "getline + substr + stoi: " << legacy << " с\n";
+    std::cout << "loadUsersFromFile, 1 поток: " << single << " с (x" << legacy / single << ")\n";
+    std::cout << "loadUsersFromFile, " << used << " потоков: " << parallel << " с (x" << legacy / parallel << ")\n";
+}
+
+// Перезапуск с каталогом из count пользователей: разбор текста против
+// открытия снимка и запросов на месте (Lab10 --bench-snapshot [n])
+void runSnapshotBenchmark(size_t count) {
+    const std::string textPath = "users_bench.txt";
+    const std::string snapshotPath = "users_bench.snap";
+    writeBenchUsers(textPath, count);
+    {
+        AccessControlSystem<User, Resource> system;
+        system.loadUsersFromFile(textPath);
+        system.addResource(Resource("Библиотека", 1));
+        system.addResource(Resource("Серверная", 5));
+        system.saveSnapshot(snapshotPath);
+    }
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    const int lookups = 1000;
+
+    double textStart = 0;
+    {
+        auto start = std::chrono::steady_clock::now();
+        AccessControlSystem<User, Resource> system;
+        system.loadUsersFromFile(textPath);
+        textStart = seconds(start);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    DirectorySnapshot snapshot(snapshotPath);
+    double openTime = seconds(start);
+    start = std::chrono::steady_clock::now();
+    size_t allowed = 0;
+    for (int k = 0; k < lookups; ++k) {
+        int id = static_cast<int>((static_cast<uint64_t>(k) * 2654435761u) % count);
+        if (auto user = snapshot.findById(id)) allowed += snapshot.checkAccess(*user, 1);
+    }
+    double lookupTime = seconds(start);
+
+    double materialize = 0;
+    {
+        AccessControlSystem<User, Resource> system;
+        start = std::chrono::steady_clock::now();
+        system.loadSnapshot(snapshot);
+        materialize = seconds(start);
+    }
+
+    std::cout << "Пользователей: " << snapshot.userCount() << ", текст " << std::filesystem::file_size(textPath)
+              << " байт, снимок " << std::filesystem::file_size(snapshotPath) << " байт\n";
+    std::cout << "Текст, loadUsersFromFile: " << textStart << " с\n";
+    std::cout << "Снимок: открытие " << openTime * 1e6 << " мкс, " << lookups << " запросов по id "
+              << lookupTime * 1e6 << " мкс (в Серверную можно " << allowed << ")\n";
+    std::cout << "Снимок -> объекты (loadSnapshot): " << materialize << " с\n";
+    std::remove(textPath.c_str());
+    std::remove(snapshotPath.c_str());
+}
+
+// Текстовый и сжатый файл пользователей: размер, запись и загрузка
+// (Lab10 --bench-compress [n])
+void runCompressBenchmark(size_t count) {
+    const std::string textPath = "users_bench.txt";
+    const std::string packedPath = "users_bench.l10z";
+    writeBenchUsers(textPath, count);
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    double textSave = 0;
+    double packedSave = 0;
+    {
+        AccessControlSystem<User, Resource> system;
+        system.loadUsersFromFile(textPath);
+        auto start = std::chrono::steady_clock::now();
+        system.saveUsersToFile(textPath);
+        textSave = seconds(start);
+        start = std::chrono::steady_clock::now();
+        system.saveUsersToFile(packedPath, UserFileFormat::Compressed);
+        packedSave = seconds(start);
+    }
+
+    double loads[2] = {};
+    size_t loaded[2] = {};
+    const std::string* paths[2] = {&textPath, &packedPath};
+    for (int k = 0; k < 2; ++k) {
+        AccessControlSystem<User, Resource> system;
+        auto start = std::chrono::steady_clock::now();
+        system.loadUsersFromFile(*paths[k]);
+        loads[k] = seconds(start);
+        loaded[k] = system.userCount();
+    }
+
+    uintmax_t textBytes = std::filesystem::file_size(textPath);
+    uintmax_t packedBytes = std::filesystem::file_size(packedPath);
+    std::cout << "Пользователей: " << loaded[0] << " / " << loaded[1] << "\n";
+    std::cout << "Текст:  " << textBytes << " байт, запись " << textSave << " с, загрузка " << loads[0] << " с\n";
+    std::cout << "Сжатый: " << packedBytes << " байт (x" << static_cast<double>(textBytes) / static_cast<double>(packedBytes)
+              << "), запись " << packedSave << " с, загрузка " << loads[1] << " с\n";
+    std::remove(textPath.c_str());
+    std::remove(packedPath.c_str());
+}
+
 // ------------------------ Main ------------------------
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench-import") {
+        try {
+            runImportBenchmark(argc > 2 ? std::stoul(argv[2]) : 5000000,
+                               argc > 3 ? static_cast<unsigned>(std::stoul(argv[3])) : 0);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-compress") {
+        try {
+            runCompressBenchmark(argc > 2 ? std::stoul(argv[2]) : 5000000);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-snapshot") {
+        try {
+            runSnapshotBenchmark(argc > 2 ? std::stoul(argv[2]) : 5000000);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
     try {
         AccessControlSystem<User, Resource> system;
 
@@ -202,6 +1054,18 @@ int main() {
         system.sortUsersByAccessLevel();
         system.showAccess();
 
+        std::cout << "\n=== Снимок каталога ===\n";
+        system.saveSnapshot("directory.snap");
+        DirectorySnapshot snapshot("directory.snap");
+        if (auto user = snapshot.findByName("Мария")) {
+            std::cout << snapshot.getName(*user) << " (" << snapshot.getDetail(*user) << "), ID: "
+                      << snapshot.getId(*user) << "\n";
+            for (size_t r = 0; r < snapshot.resourceCount(); ++r) {
+                std::cout << "  -> " << snapshot.getResourceName(r)
+                          << (snapshot.checkAccess(*user, r) ? ": доступ разрешён\n" : ": доступ запрещён\n");
+            }
+        }
+
     } catch (const std::exception& e) {
         std::cerr << "Ошибка: " << e.what() << "\n";
     }
@@ -5,202 +5,2405 @@
 #include <memory>
 #include <algorithm>
 #include <stdexcept>
+#include <string_view>
+#include <iterator>
+#include <sstream>
+#include <filesystem>
+#include <cstdint>
+#include <ctime>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <unordered_map>
+#include <type_traits>
+#include <charconv>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <optional>
+#include <array>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block_codec.h"
+#endif
+
+// ---------- Генератор бросков: счётчиковый Philox4x32-10 ----------
+// Бросок определяется тройкой (seed, streamId, номер), так что у каждой
+// игры свой воспроизводимый поток и общий rand() не нужен.
+class RollStream {
+private:
+    uint32_t key[2];
+    uint32_t counter[4];   // [0..1] - номер блока, [2..3] - id потока
+    uint32_t block[4];
+    unsigned used = 4;     // сколько слов текущего блока уже выдано
+
+    static uint64_t splitmix64(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    void generate(uint32_t out[4]) {
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c0;
+            uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * c2;
+            c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            c1 = static_cast<uint32_t>(p1);
+            c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c3 = static_cast<uint32_t>(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+        if (++counter[0] == 0) ++counter[1];
+    }
+
+    // Отображает 32-битное слово в [0, bound) умножением, без деления
+    static int scale(uint32_t x, uint32_t bound) {
+        return static_cast<int>((static_cast<uint64_t>(x) * bound) >> 32);
+    }
+
+    static int toPercent(uint32_t x) {
+        return scale(x, 100);
+    }
+
+public:
+    RollStream(uint64_t seed, uint64_t streamId) {
+        uint64_t k = splitmix64(seed);
+        key[0] = static_cast<uint32_t>(k);
+        key[1] = static_cast<uint32_t>(k >> 32);
+        counter[0] = counter[1] = 0;
+        counter[2] = static_cast<uint32_t>(streamId);
+        counter[3] = static_cast<uint32_t>(streamId >> 32);
+    }
+
+    uint32_t next() {
+        if (used == 4) {
+            generate(block);
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    // Случайное число 0..bound-1
+    int below(uint32_t bound) {
+        return scale(next(), bound);
+    }
+
+    // Бросок 0..99 для проверок вида "roll < шанс"
+    int percent() {
+        return toPercent(next());
+    }
+
+    // Пачка бросков за один вызов; даёт ту же последовательность, что и percent()
+    void fillPercent(int* out, size_t count) {
+        size_t i = 0;
+        while (i < count && used < 4) out[i++] = toPercent(block[used++]);
+        uint32_t words[4];
+        for (; i + 4 <= count; i += 4) {
+            generate(words);
+            for (int j = 0; j < 4; ++j) out[i + j] = toPercent(words[j]);
+        }
+        for (; i < count; ++i) out[i] = percent();
+    }
+};
+
+// ---------- Журналы: фоновый писатель, Logger и двоичный EventLog ----------
+// Уровни и категории записей
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error, Off };
+enum class LogCategory : uint8_t { Combat, Inventory, Progression, Persistence };
+
+constexpr std::string_view kLogLevelNames[] = {"trace", "debug", "info", "warn", "error", "off"};
+constexpr std::string_view kLogCategoryNames[] = {"combat", "inventory", "progression", "persistence"};
+constexpr size_t kLogCategoryCount = std::size(kLogCategoryNames);
+
+// Нижний уровень на этапе компиляции: записи ниже него вырезаются из
+// программы целиком (например, -DLAB9_MIN_LOG_LEVEL=2 оставляет info и выше)
+#ifndef LAB9_MIN_LOG_LEVEL
+#define LAB9_MIN_LOG_LEVEL 0
+#endif
+constexpr LogLevel kMinLogLevel = static_cast<LogLevel>(LAB9_MIN_LOG_LEVEL);
+
+// Фильтр во время работы: свой порог для каждой категории. По умолчанию
+// пишется всё; читается из игровых потоков без блокировок.
+class LogFilter {
+private:
+    std::atomic<uint8_t> thresholds[kLogCategoryCount] = {};
+
+    template<size_t N>
+    static bool lookup(const std::string_view (&names)[N], std::string_view name, size_t& index) {
+        for (index = 0; index < N; ++index) {
+            if (names[index] == name) return true;
+        }
+        return false;
+    }
+
+public:
+    bool enabled(LogLevel level, LogCategory category) const {
+        return static_cast<uint8_t>(level) >=
+               thresholds[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+    }
+
+    LogLevel level(LogCategory category) const {
+        return static_cast<LogLevel>(thresholds[static_cast<size_t>(category)].load(std::memory_order_relaxed));
+    }
+
+    void setLevel(LogCategory category, LogLevel level) {
+        thresholds[static_cast<size_t>(category)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+
+    // Разбирает "info" (для всех категорий) или "combat=warn,inventory=off";
+    // false - неизвестный уровень или категория
+    bool configure(std::string_view spec) {
+        while (!spec.empty()) {
+            std::string_view item = spec.substr(0, spec.find(','));
+            spec.remove_prefix(std::min(spec.size(), item.size() + 1));
+
+            size_t eq = item.find('=');
+            size_t level = 0;
+            if (!lookup(kLogLevelNames, eq == std::string_view::npos ? item : item.substr(eq + 1), level)) return false;
+            if (eq == std::string_view::npos) {
+                for (size_t c = 0; c < kLogCategoryCount; ++c) setLevel(static_cast<LogCategory>(c), static_cast<LogLevel>(level));
+                continue;
+            }
+            size_t category = 0;
+            if (!lookup(kLogCategoryNames, item.substr(0, eq), category)) return false;
+            setLevel(static_cast<LogCategory>(category), static_cast<LogLevel>(level));
+        }
+        return true;
+    }
+};
+
+// Общий фильтр процесса; Lab9 настраивает его из переменной LAB9_LOG
+LogFilter logFilter;
+
+// Насколько быстро запись журнала доходит до файла
+enum class LogDurability {
+    Sync,        // сразу в файл со сбросом на каждой записи (прежнее поведение)
+    BatchFlush,  // фоновый поток пишет пачками и сбрасывает файл после каждой
+    Buffered     // фоновый поток пишет пачками, сброс - по flush() и при закрытии
+};
+
+// Сегменты журнала: файлы путь.000001, путь.000002, ... заранее выделенного
+// размера. Заполненный сегмент закрывается, старые удаляются по числу или возрасту.
+struct LogSegments {
+    size_t segmentBytes = 1 << 20;
+    size_t keepCount = 8;             // 0 - без ограничения
+    std::chrono::seconds maxAge{0};   // 0 - без ограничения
+};
+
+#ifndef _WIN32
+// Запись в сегменты через mmap: добавление - memcpy в отображённую память.
+// Пачка никогда не делится между сегментами, так что каждый сегмент читается
+// отдельно. Записи, пришедшие во время ошибки файловой системы, теряются, как
+// и у ofstream; сама ошибка один раз сообщается в stderr.
+class LogSegmentStore {
+private:
+    std::filesystem::path base;
+    LogSegments config;
+    uint64_t index = 0;
+    int fd = -1;
+    char* mapped = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    bool failed = false;   // последний openSegment не удался: повторяем тот же номер
+
+    static std::filesystem::path segmentPath(const std::filesystem::path& base, uint64_t index) {
+        char suffix[24];
+        std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(index));
+        return std::filesystem::path(base.string() + suffix);
+    }
+
+    // Дописанный сегмент обрезается до занятой длины
+    void closeSegment() {
+        if (mapped) {
+            munmap(mapped, capacity);
+            mapped = nullptr;
+        }
+        if (fd >= 0) {
+            if (ftruncate(fd, static_cast<off_t>(used)) != 0)
+                std::cerr << "Журнал: не удалось обрезать " << segmentPath(base, index).string()
+                          << ": " << std::strerror(errno) << "\n";
+            ::close(fd);
+            fd = -1;
+        }
+        capacity = used = 0;
+    }
+
+    // Открывает сегмент (недописанный - продолжает с его конца).
+    // При ошибке сообщает о ней (один раз подряд) и возвращает false
+    bool openSegment(uint64_t i, size_t minBytes) {
+        index = i;
+        const char* step = nullptr;
+        fd = ::open(segmentPath(base, i).c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            step = "открыть";
+        } else {
+            struct stat info;
+            used = fstat(fd, &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+            capacity = std::max(config.segmentBytes, used + minBytes);
+            if (posix_fallocate(fd, 0, static_cast<off_t>(capacity)) != 0 &&
+                ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+                step = "выделить место под";
+            } else {
+                void* memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (memory == MAP_FAILED) step = "отобразить";
+                else mapped = static_cast<char*>(memory);
+            }
+        }
+        if (step) {
+            int code = errno;
+            closeSegment();
+            if (!failed)
+                std::cerr << "Журнал: не удалось " << step << " " << segmentPath(base, i).string()
+                          << ": " << std::strerror(code) << "\n";
+            failed = true;
+            return false;
+        }
+        failed = false;
+        return true;
+    }
+
+    // Удаляет лишние и устаревшие сегменты; текущий не трогает
+    void enforceRetention() {
+        std::vector<std::pair<uint64_t, std::filesystem::path>> segments = list(base);
+        auto oldest = std::filesystem::file_time_type::clock::now() - config.maxAge;
+        size_t excess = config.keepCount && segments.size() > config.keepCount ? segments.size() - config.keepCount : 0;
+        std::error_code error;
+        for (size_t s = 0; s < segments.size() && segments[s].first != index; ++s) {
+            bool expired = config.maxAge.count() > 0 && std::filesystem::last_write_time(segments[s].second, error) < oldest;
+            if (s < excess || expired) std::filesystem::remove(segments[s].second, error);
+        }
+    }
+
+public:
+    LogSegmentStore(const std::filesystem::path& base, const LogSegments& config) : base(base), config(config) {
+        std::vector<std::pair<uint64_t, std::filesystem::path>> segments = list(base);
+        uint64_t last = segments.empty() ? 0 : segments.back().first;
+        std::error_code error;
+        bool reusable = last > 0 && std::filesystem::file_size(segments.back().second, error) < config.segmentBytes;
+        if (openSegment(reusable ? last : last + 1, 0)) enforceRetention();
+    }
+
+    ~LogSegmentStore() {
+        closeSegment();
+    }
+
+    LogSegmentStore(const LogSegmentStore&) = delete;
+    LogSegmentStore& operator=(const LogSegmentStore&) = delete;
+
+    // Существующие сегменты журнала base по возрастанию номера
+    static std::vector<std::pair<uint64_t, std::filesystem::path>> list(const std::filesystem::path& base) {
+        std::vector<std::pair<uint64_t, std::filesystem::path>> segments;
+        std::filesystem::path dir = base.has_parent_path() ? base.parent_path() : std::filesystem::path(".");
+        std::string prefix = base.filename().string() + ".";
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() != prefix.size() + 6 || name.compare(0, prefix.size(), prefix) != 0) continue;
+            uint64_t number = 0;
+            auto result = std::from_chars(name.data() + prefix.size(), name.data() + name.size(), number);
+            if (result.ec == std::errc() && result.ptr == name.data() + name.size())
+                segments.emplace_back(number, entry.path());
+        }
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    void write(const char* data, size_t size) {
+        if (used + size > capacity) {
+            // После неудачного открытия пробуем тот же номер ещё раз, а не
+            // заводим новый файл и не чистим старые сегменты на каждой записи
+            uint64_t next = failed ? index : index + 1;
+            closeSegment();
+            if (!openSegment(next, size)) return;
+            enforceRetention();
+        }
+        std::memcpy(mapped + used, data, size);
+        used += size;
+    }
+
+    // Данные уже в страничном кэше; просим ядро начать запись на диск
+    void flush() {
+        if (mapped) msync(mapped, used, MS_ASYNC);
+    }
+};
+#endif
+
+// Файл журнала: обычный (дописывается через ofstream) или набор сегментов.
+// Логгеры одного пути делят один LogFile; он живёт, пока на него ссылается
+// логгер или пачка в очереди писателя.
+class LogFile {
+private:
+    std::mutex mutex;   // пишет фоновый поток, в режиме Sync - сами логгеры
+    std::ofstream stream;
+#ifndef _WIN32
+    std::unique_ptr<LogSegmentStore> segments;
+#endif
+
+public:
+    LogFile(const std::string& path, std::ios::openmode mode, const std::optional<LogSegments>& segmentConfig) {
+#ifndef _WIN32
+        if (segmentConfig) {
+            segments = std::make_unique<LogSegmentStore>(path, *segmentConfig);
+            return;
+        }
+#endif
+        stream.open(path, mode | std::ios::app);
+    }
+
+    static std::shared_ptr<LogFile> open(const std::string& path, std::ios::openmode mode,
+                                         const std::optional<LogSegments>& segmentConfig) {
+        static std::mutex registryMutex;
+        static std::vector<std::pair<std::string, std::weak_ptr<LogFile>>> registry;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.erase(std::remove_if(registry.begin(), registry.end(),
+                                      [](const auto& entry) { return entry.second.expired(); }),
+                       registry.end());
+        for (const auto& [registered, weak] : registry) {
+            if (registered == path) {
+                if (auto file = weak.lock()) return file;
+            }
+        }
+        auto file = std::make_shared<LogFile>(path, mode, segmentConfig);
+        registry.emplace_back(path, file);
+        return file;
+    }
+
+    void write(const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+#ifndef _WIN32
+        if (segments) {
+            segments->write(data, size);
+            return;
+        }
+#endif
+        stream.write(data, static_cast<std::streamsize>(size));
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+#ifndef _WIN32
+        if (segments) {
+            segments->flush();
+            return;
+        }
+#endif
+        stream.flush();
+    }
+};
+
+// Фоновый писатель журналов: один поток на процесс. Логгеры отдают ему
+// готовые пачки, каждая пачка пишется в файл одной операцией, а её буфер
+// возвращается в запас и достаётся следующему логгеру без выделения памяти.
+class LogWriter {
+private:
+    struct Batch {
+        std::shared_ptr<LogFile> file;
+        std::string data;
+        bool flushFile;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;   // писателю: появилась работа
+    std::condition_variable done;   // логгерам: очередная пачка записана
+    std::deque<Batch> pending;
+    std::vector<std::string> spare; // записанные буферы для повторного использования
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    bool stopping = false;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break;   // остановка, и очередь уже пуста
+
+            std::deque<Batch> work;
+            work.swap(pending);
+            lock.unlock();
+            for (Batch& batch : work) {
+                batch.file->write(batch.data.data(), batch.data.size());
+                if (batch.flushFile) batch.file->flush();
+                batch.file.reset();   // последняя ссылка закрывает файл вне блокировки
+                batch.data.clear();
+            }
+            lock.lock();
+            for (Batch& batch : work) {
+                if (spare.size() < 64) spare.push_back(std::move(batch.data));
+            }
+            completed = submitted - pending.size();
+            done.notify_all();
+        }
+    }
+
+    LogWriter() : worker(&LogWriter::run, this) {}
+
+public:
+    // Запускается при первой асинхронной записи; при выходе из программы
+    // дописывает всю очередь и останавливает поток
+    static LogWriter& instance() {
+        static LogWriter writer;
+        return writer;
+    }
+
+    ~LogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    // Забирает data в очередь и отдаёт взамен пустой буфер из запаса;
+    // возвращает номер пачки для waitFor()
+    uint64_t submit(std::shared_ptr<LogFile> file, std::string& data, bool flushFile, size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({std::move(file), std::move(data), flushFile});
+        if (!spare.empty()) {
+            data = std::move(spare.back());
+            spare.pop_back();
+        } else {
+            data = std::string();
+            data.reserve(capacity);
+        }
+        wake.notify_one();
+        return ++submitted;
+    }
+
+    // Ждёт, пока пачка ticket и все поставленные до неё окажутся в файле
+    void waitFor(uint64_t ticket) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return completed >= ticket; });
+    }
+};
+
+// Общая часть логгеров: свой буфер (его трогает только поток-владелец)
+// и передача накопленного писателю пачками
+class LogChannel {
+protected:
+    static constexpr size_t kBatchBytes = 4096;
+
+    std::shared_ptr<LogFile> file;
+    LogDurability durability;
+    std::string buffer;        // записи, ещё не отданные писателю
+    uint64_t lastTicket = 0;
+
+    LogChannel(const std::string& filename, LogDurability durability, std::ios::openmode mode,
+               const std::optional<LogSegments>& segments)
+        : file(LogFile::open(filename, mode, segments)), durability(durability) {
+        buffer.reserve(kBatchBytes * 2);
+    }
+
+    // Недописанный остаток уходит писателю; файл закроется после записи
+    ~LogChannel() {
+        if (durability != LogDurability::Sync) handOff(false);
+    }
+
+    void handOff(bool flushFile) {
+        if (buffer.empty() && !flushFile) return;
+        lastTicket = LogWriter::instance().submit(file, buffer, flushFile, kBatchBytes * 2);
+    }
+
+    // Запись дописана в buffer: в режиме Sync сразу уходит в файл,
+    // иначе - писателю, когда наберётся пачка. true - буфер ушёл целиком
+    // и следующая запись начинает новую пачку.
+    bool commit() {
+        if (durability == LogDurability::Sync) {
+            file->write(buffer.data(), buffer.size());
+            file->flush();
+            buffer.clear();
+            return true;
+        }
+        if (buffer.size() < kBatchBytes) return false;
+        handOff(durability == LogDurability::BatchFlush);
+        return true;
+    }
+
+public:
+    LogChannel(const LogChannel&) = delete;
+    LogChannel& operator=(const LogChannel&) = delete;
+
+    // Отдаёт накопленное и ждёт, пока оно окажется в файле
+    void flush() {
+        if (durability == LogDurability::Sync) {
+            file->flush();
+            return;
+        }
+        handOff(true);
+        LogWriter::instance().waitFor(lastTicket);
+    }
+};
 
 // ---------- Шаблонный класс Logger ----------
+// Текстовый журнал: одна строка на запись
 template<typename T>
-class Logger {
+class Logger : public LogChannel {
 private:
-    std::ofstream logFile;
+    template<typename V>
+    void append(const V& value) {
+        if constexpr (std::is_convertible_v<const V&, std::string_view>) {
+            buffer.append(std::string_view(value));
+        } else if constexpr (std::is_same_v<V, char>) {
+            buffer += value;
+        } else if constexpr (std::is_arithmetic_v<V>) {
+            char digits[32];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            buffer.append(digits, result.ptr);
+        } else {
+            std::ostringstream text;
+            text << value;
+            buffer += text.str();
+        }
+    }
+
 public:
-    Logger(const std::string& filename) {
-        logFile.open(filename, std::ios::app);
+    Logger(const std::string& filename, LogDurability durability = LogDurability::BatchFlush)
+        : LogChannel(filename, durability, std::ios::out, std::nullopt) {}
+
+    Logger(const std::string& filename, const LogSegments& segments, LogDurability durability = LogDurability::BatchFlush)
+        : LogChannel(filename, durability, std::ios::out, segments) {}
+
+    void log(const T& entry) {
+        append(entry);
+        buffer += '\n';
+        commit();
     }
-    ~Logger() {
-        if (logFile.is_open()) logFile.close();
+
+    // Запись с уровнем и категорией, например
+    //   logger.log<LogLevel::Debug>(LogCategory::Combat, name, " атакует на ", damage);
+    // Аргументы берутся по ссылке и форматируются прямо в буфер, только если
+    // запись прошла фильтр; ниже kMinLogLevel вызов не компилируется в код.
+    template<LogLevel Level, typename... Args>
+    void log(LogCategory category, const Args&... args) {
+        if constexpr (Level >= kMinLogLevel) {
+            if (!logFilter.enabled(Level, category)) return;
+            buffer += '[';
+            buffer.append(kLogLevelNames[static_cast<size_t>(Level)]);
+            buffer += "][";
+            buffer.append(kLogCategoryNames[static_cast<size_t>(category)]);
+            buffer += "] ";
+            (append(args), ...);
+            buffer += '\n';
+            commit();
+        }
     }
-    void log(const T& entry) {
-        logFile << entry << std::endl;
+};
+
+// ---------- Двоичный журнал событий ----------
+// События персонажа; текст восстанавливает декодер:
+//   X(идентификатор, категория, уровень, есть цель, есть число, шаблон строки)
+// {a} - действующее лицо, {t} - цель или предмет, {v} - число
+#define LOG_EVENTS(X)                                                                      \
+    X(Attack,     Combat,      Debug, true,  true,  "{a} атакует {t} на {v} урона.")        \
+    X(TakeDamage, Combat,      Debug, false, true,  "{a} получает {v} урона.")              \
+    X(Heal,       Combat,      Info,  false, true,  "{a} лечится на {v} HP.")               \
+    X(LevelUp,    Progression, Info,  false, true,  "{a} повысил уровень до {v}")           \
+    X(ItemGained, Inventory,   Info,  true,  false, "{a} получает предмет: {t}")            \
+    X(Saved,      Persistence, Info,  false, false, "{a} сохраняет игру.")                  \
+    X(Loaded,     Persistence, Info,  false, false, "{a} загружает игру.")
+
+enum class LogEvent : uint8_t {
+#define LOG_EVENT_ENUM(id, category, level, hasTarget, hasValue, text) id,
+    LOG_EVENTS(LOG_EVENT_ENUM)
+#undef LOG_EVENT_ENUM
+};
+
+struct LogEventFormat {
+    LogCategory category;
+    LogLevel level;
+    bool hasTarget;
+    bool hasValue;
+    std::string_view text;
+};
+
+constexpr LogEventFormat kLogEventFormats[] = {
+#define LOG_EVENT_ROW(id, category, level, hasTarget, hasValue, text) \
+    {LogCategory::category, LogLevel::level, hasTarget, hasValue, text},
+    LOG_EVENTS(LOG_EVENT_ROW)
+#undef LOG_EVENT_ROW
+};
+
+constexpr uint8_t kLogEventCount = static_cast<uint8_t>(std::size(kLogEventFormats));
+
+// Формат файла - последовательность записей, числа в varint (block_codec.h):
+//   Session: 0, версия, unix-время в мкс (в версии 1 - в мс)  (сбрасывает таблицу имён)
+//   Name:    1, id, длина, байты имени           (до первого использования id)
+//   Event:   16 + LogEvent, мкс от прошлой записи, id лица,
+//            [id цели], [число в zigzag]
+// Каждая пачка начинается с Session и сама объявляет свои имена, поэтому
+// любой сегмент журнала читается без предыдущих.
+enum LogRecordKind : uint8_t { kLogSession = 0, kLogName = 1, kLogEventBase = 16 };
+constexpr uint8_t kEventLogVersion = 2;
+
+// Журнал событий персонажа. Запись события - несколько байт в буфер без
+// выделения памяти; имена передаются один раз и дальше идут номерами.
+class EventLog : public LogChannel {
+private:
+    std::vector<std::string> names;   // id -> имя (имён в игре единицы)
+    std::chrono::steady_clock::time_point last;
+    bool sessionPending = true;       // следующая запись открывает пачку
+
+    void beginSession() {
+        names.clear();
+        last = std::chrono::steady_clock::now();
+        auto unixUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        buffer += static_cast<char>(kLogSession);
+        buffer += static_cast<char>(kEventLogVersion);
+        appendVarint(buffer, static_cast<uint64_t>(unixUs));
+        sessionPending = false;
+    }
+
+    uint64_t intern(std::string_view name) {
+        for (size_t id = 0; id < names.size(); ++id) {
+            if (names[id] == name) return id;
+        }
+        names.emplace_back(name);
+        buffer += static_cast<char>(kLogName);
+        appendVarint(buffer, names.size() - 1);
+        appendVarint(buffer, name.size());
+        buffer.append(name);
+        return names.size() - 1;
+    }
+
+public:
+    EventLog(const std::string& filename, LogDurability durability = LogDurability::BatchFlush)
+        : LogChannel(filename, durability, std::ios::out | std::ios::binary, std::nullopt) {}
+
+    EventLog(const std::string& filename, const LogSegments& segments, LogDurability durability = LogDurability::BatchFlush)
+        : LogChannel(filename, durability, std::ios::out | std::ios::binary, segments) {}
+
+    void flush() {
+        LogChannel::flush();
+        sessionPending = true;
+    }
+
+    // Уровень и категория события берутся из таблицы LOG_EVENTS: события
+    // ниже kMinLogLevel не компилируются, отфильтрованные ничего не пишут
+    template<LogEvent Event>
+    void record(std::string_view actor, std::string_view target = {}, int value = 0) {
+        constexpr LogEventFormat format = kLogEventFormats[static_cast<size_t>(Event)];
+        if constexpr (format.level >= kMinLogLevel) {
+            if (logFilter.enabled(format.level, format.category)) write(Event, format, actor, target, value);
+        }
+    }
+
+private:
+    void write(LogEvent event, const LogEventFormat& format, std::string_view actor, std::string_view target, int value) {
+        if (sessionPending) beginSession();
+        uint64_t actorId = intern(actor);
+        uint64_t targetId = format.hasTarget ? intern(target) : 0;
+
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+        last = now;
+
+        buffer += static_cast<char>(kLogEventBase + static_cast<uint8_t>(event));
+        appendVarint(buffer, static_cast<uint64_t>(elapsed));
+        appendVarint(buffer, actorId);
+        if (format.hasTarget) appendVarint(buffer, targetId);
+        if (format.hasValue) appendVarint(buffer, zigzag(value));
+        if (commit()) sessionPending = true;
     }
 };
 
+// Переводит двоичный журнал (файл или один сегмент) обратно в текст, по
+// строке на событие; withTime добавляет местное время события.
+// Возвращает число событий.
+size_t decodeEventLog(std::istream& in, std::ostream& out, bool withTime = false) {
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const char* p = data.data();
+    const char* end = p + data.size();
+    std::vector<std::string> names;
+    uint64_t timeUs = 0;
+    size_t events = 0;
+
+    auto corrupt = [] { return std::runtime_error("Повреждённый журнал событий!"); };
+    auto name = [&](uint64_t id) -> const std::string& {
+        if (id >= names.size()) throw corrupt();
+        return names[id];
+    };
+
+    while (p < end) {
+        uint8_t kind = static_cast<uint8_t>(*p++);
+        uint64_t a = 0, b = 0, c = 0, d = 0;
+        if (kind == kLogSession) {
+            // Хвост из нулей - невыписанный остаток сегмента после аварийного выхода
+            if (std::all_of(p, end, [](char byte) { return byte == 0; })) break;
+            uint8_t version = p < end ? static_cast<uint8_t>(*p++) : 0;
+            if ((version != 1 && version != kEventLogVersion) || !readVarint(p, end, a)) throw corrupt();
+            names.clear();
+            timeUs = version == 1 ? a * 1000 : a;
+        } else if (kind == kLogName) {
+            if (!readVarint(p, end, a) || !readVarint(p, end, b) || a != names.size() ||
+                b > static_cast<uint64_t>(end - p)) throw corrupt();
+            names.emplace_back(p, b);
+            p += b;
+        } else if (kind >= kLogEventBase && kind < kLogEventBase + kLogEventCount) {
+            const LogEventFormat& format = kLogEventFormats[kind - kLogEventBase];
+            if (!readVarint(p, end, a) || !readVarint(p, end, b) ||
+                (format.hasTarget && !readVarint(p, end, c)) ||
+                (format.hasValue && !readVarint(p, end, d))) throw corrupt();
+            timeUs += a;
+            int value = static_cast<int>(unzigzag(d));
+
+            if (withTime) {
+                std::time_t seconds = static_cast<std::time_t>(timeUs / 1000000);
+                char stamp[32];
+                size_t length = std::strftime(stamp, sizeof(stamp), "%H:%M:%S", std::localtime(&seconds));
+                std::snprintf(stamp + length, sizeof(stamp) - length, ".%03u", static_cast<unsigned>(timeUs / 1000 % 1000));
+                out << '[' << stamp << "] ";
+            }
+            std::string_view text = format.text;
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] == '{' && i + 2 < text.size() && text[i + 2] == '}') {
+                    if (text[i + 1] == 'a') out << name(b);
+                    else if (text[i + 1] == 't') out << name(c);
+                    else out << value;
+                    i += 2;
+                } else {
+                    out << text[i];
+                }
+            }
+            out << '\n';
+            ++events;
+        } else {
+            throw corrupt();
+        }
+    }
+    return events;
+}
+
 // ---------- Шаблонный класс Inventory ----------
+// Изменение инвентаря с последнего сохранения: добавлено count таких
+// предметов или убраны все такие предметы (count не используется)
+template<typename T>
+struct InventoryChange {
+    bool added;
+    T item;
+    size_t count = 1;
+};
+
 template<typename T>
 class Inventory {
+public:
+    using Change = InventoryChange<T>;
+
 private:
     std::vector<T> items;
+    std::vector<Change> changes;
 public:
     void addItem(const T& item) {
         items.push_back(item);
+        changes.push_back({true, item});
     }
     void removeItem(const T& item) {
         items.erase(std::remove(items.begin(), items.end(), item), items.end());
+        changes.push_back({false, item});
+    }
+    size_t count(const T& item) const {
+        return static_cast<size_t>(std::count(items.begin(), items.end(), item));
     }
-    void display() const {
-        std::cout << "Инвентарь:\n";
+    void display(std::ostream& out = std::cout) const {
+        out << "Инвентарь:\n";
         for (const auto& item : items) {
-            std::cout << "- " << item << std::endl;
+            out << "- " << item << std::endl;
         }
     }
     const std::vector<T>& getItems() const {
         return items;
     }
+    const std::vector<Change>& pendingChanges() const {
+        return changes;
+    }
+    void clearChanges() {
+        changes.clear();
+    }
 };
 
-// ---------- Класс Monster (и наследники) ----------
-class Character;
+// Инвентарь со стопками: одинаковые предметы хранятся один раз со счётчиком,
+// стопки ищутся по хеш-таблице с открытой адресацией (линейное пробирование).
+// Добавление, удаление и подсчёт - O(1), память растёт с числом разных
+// предметов, а не подборов. Стопки перечисляются в порядке первого подбора.
+// removeItem, как и у Inventory, убирает все такие предметы сразу.
+// Несохранённые изменения тоже сворачиваются по предметам: у стопки - число
+// подборов с прошлого сохранения, отдельно - список убранных предметов.
+template<typename T, typename Hash = std::hash<T>>
+class StackedInventory {
+public:
+    using Change = InventoryChange<T>;
+
+private:
+    struct Stack {
+        T item;
+        size_t count;     // 0 - стопка удалена и ждёт перестройки
+        size_t hash;
+        size_t pending;   // подобрано с прошлого сохранения
+        bool fresh;       // стопка заведена после прошлого сохранения
+    };
+
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    static constexpr uint32_t kDeleted = UINT32_MAX - 1;
+
+    std::vector<Stack> stacks;     // в порядке первого подбора
+    std::vector<uint32_t> slots;   // номера стопок; размер - степень двойки
+    size_t live = 0;               // непустых стопок
+    size_t used = 0;               // занятых слотов вместе с kDeleted
+    size_t total = 0;              // предметов во всех стопках
+    std::vector<T> removed;        // убраны с прошлого сохранения, каждый не больше раза
+    Hash hasher;
+
+    // Слот с предметом (found = true) или слот, куда его вставить
+    size_t findSlot(const T& item, size_t hash, bool& found) const {
+        size_t mask = slots.size() - 1;
+        size_t insertAt = SIZE_MAX;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t index = slots[i];
+            if (index == kEmpty) {
+                found = false;
+                return insertAt != SIZE_MAX ? insertAt : i;
+            }
+            if (index == kDeleted) {
+                if (insertAt == SIZE_MAX) insertAt = i;
+                continue;
+            }
+            const Stack& stack = stacks[index];
+            if (stack.hash == hash && stack.item == item) {
+                found = true;
+                return i;
+            }
+        }
+    }
+
+    // Выбрасывает удалённые стопки и раскладывает остальные заново,
+    // так что таблица заполнена не больше чем на четверть
+    void rebuild() {
+        std::erase_if(stacks, [](const Stack& stack) { return stack.count == 0; });
+        size_t size = 16;
+        while (size < stacks.size() * 4) size *= 2;
+        slots.assign(size, kEmpty);
+        for (size_t index = 0; index < stacks.size(); ++index) {
+            size_t i = stacks[index].hash & (size - 1);
+            while (slots[i] != kEmpty) i = (i + 1) & (size - 1);
+            slots[i] = static_cast<uint32_t>(index);
+        }
+        used = stacks.size();
+    }
 
-class Monster {
-protected:
-    std::string name;
-    int hp;
-    int attackPower;
-    int defense;
 public:
-    Monster(std::string n, int h, int a, int d) : name(n), hp(h), attackPower(a), defense(d) {}
-    virtual ~Monster() {}
+    void addItem(const T& item) {
+        if ((used + 1) * 2 > slots.size()) rebuild();
+        size_t hash = hasher(item);
+        bool found = false;
+        size_t slot = findSlot(item, hash, found);
+        if (found) {
+            Stack& stack = stacks[slots[slot]];
+            ++stack.count;
+            ++stack.pending;
+        } else {
+            if (slots[slot] == kEmpty) ++used;
+            slots[slot] = static_cast<uint32_t>(stacks.size());
+            stacks.push_back({item, 1, hash, 1, true});
+            ++live;
+        }
+        ++total;
+    }
 
-    virtual void attack(Character& c);
-    virtual void display() const {
-        std::cout << name << " (HP: " << hp << ", ATK: " << attackPower << ", DEF: " << defense << ")\n";
+    void removeItem(const T& item) {
+        bool found = false;
+        size_t slot = slots.empty() ? 0 : findSlot(item, hasher(item), found);
+        if (found) {
+            Stack& stack = stacks[slots[slot]];
+            // Стопку, заведённую после сохранения, в сохранении убирать незачем:
+            // её предмета там нет или его удаление уже записано
+            if (!stack.fresh) removed.push_back(std::move(stack.item));
+            total -= stack.count;
+            stack.count = 0;
+            stack.pending = 0;
+            stack.item = T();
+            slots[slot] = kDeleted;
+            --live;
+            if (stacks.size() > 2 * live + 16) rebuild();
+        }
     }
 
-    void takeDamage(int dmg) {
-        hp -= dmg;
-        if (hp < 0) throw std::runtime_error(name + " умер!");
+    size_t count(const T& item) const {
+        bool found = false;
+        size_t slot = slots.empty() ? 0 : findSlot(item, hasher(item), found);
+        return found ? stacks[slots[slot]].count : 0;
     }
 
-    bool isDead() const { return hp <= 0; }
-    std::string getName() const { return name; }
-    int getHP() const { return hp; }
-    int getAttack() const { return attackPower; }
-    int getDefense() const { return defense; }
+    size_t size() const { return total; }
+    size_t distinctCount() const { return live; }
+
+    // visit(предмет, сколько их) для каждой стопки в порядке первого подбора
+    template<typename Visit>
+    void forEachStack(Visit&& visit) const {
+        for (const Stack& stack : stacks) {
+            if (stack.count > 0) visit(stack.item, stack.count);
+        }
+    }
+
+    void display(std::ostream& out = std::cout) const {
+        out << "Инвентарь:\n";
+        forEachStack([&out](const T& item, size_t count) {
+            out << "- " << item;
+            if (count > 1) out << " x" << count;
+            out << std::endl;
+        });
+    }
+
+    // Плоский список, как у Inventory: каждая стопка - count копий подряд
+    std::vector<T> getItems() const {
+        std::vector<T> items;
+        items.reserve(total);
+        forEachStack([&items](const T& item, size_t count) { items.insert(items.end(), count, item); });
+        return items;
+    }
+
+    bool hasPendingChanges() const {
+        if (!removed.empty()) return true;
+        return std::any_of(stacks.begin(), stacks.end(), [](const Stack& stack) { return stack.pending > 0; });
+    }
+
+    // Изменения с прошлого сохранения, по одному на предмет: сначала все
+    // удаления, затем добавления в порядке стопок. Применённые по порядку к
+    // прежнему списку, они дают те же предметы в том же порядке первых подборов.
+    std::vector<Change> pendingChanges() const {
+        std::vector<Change> net;
+        for (const T& item : removed) net.push_back({false, item});
+        for (const Stack& stack : stacks) {
+            if (stack.pending > 0) net.push_back({true, stack.item, stack.pending});
+        }
+        return net;
+    }
+    void clearChanges() {
+        removed.clear();
+        for (Stack& stack : stacks) {
+            stack.pending = 0;
+            stack.fresh = false;
+        }
+    }
+};
+
+// ---------- Блочное сжатие ----------
+// LZ-блоки, кадры и varint/zigzag - общие с Lab10 и lab7.1, в block_codec.h.
+// Компактное сохранение режет текст на блоки по kCompressBlockBytes.
+constexpr size_t kCompressBlockBytes = 64 * 1024;
+
+// ---------- Формат сохранения ----------
+// Состояние персонажа, которое попадает в файл сохранения
+struct SaveData {
+    std::string name;
+    int hp = 100;
+    int attackPower = 10;
+    int defense = 5;
+    int level = 1;
+    int experience = 0;
+    std::vector<std::string> items;
 };
 
-class Goblin : public Monster {
-public:
-    Goblin() : Monster("Гоблин", 30, 5, 2) {}
-};
+// Двоичное сохранение, все числа little-endian:
+//   заголовок (16 байт): "L9SV", u16 версия, u16 резерв, u32 длина данных, u32 CRC-32 данных
+//   данные версии 1: i32 hp, attack, defense, level, experience;
+//           u32 длина имени, имя; u32 число предметов, затем у каждого u32 длина и байты
+//   данные версии 2 (компактной) - кадры блочного сжатия, а внутри: varint число
+//           строк словаря, строки (varint длина, байты); zigzag-varint hp, attack,
+//           defense, level, experience; varint номер имени в словаре; varint число
+//           предметов и varint номер каждого - повторяющиеся предметы хранятся один раз
+// Имя и предметы хранятся как есть, так что пробелы и переводы строк в них допустимы.
+constexpr char kSaveMagic[4] = {'L', '9', 'S', 'V'};
+constexpr uint16_t kSavePlainVersion = 1;
+constexpr uint16_t kSaveCompactVersion = 2;
+constexpr size_t kSaveHeaderBytes = 16;
+
+enum class SaveEncoding { Plain, Compact };
+
+// Как пишутся новые сохранения; LAB9_SAVE=compact включает сжатие
+SaveEncoding saveEncoding = SaveEncoding::Plain;
+
+inline void putU32(std::string& out, uint32_t value) {
+    char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                     static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+    out.append(bytes, 4);
+}
+
+inline uint32_t getU32(const char* p) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(p[0])) |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24;
+}
+
+// CRC-32 (полином 0xEDB88320) с обработкой по 8 байт: таблица k даёт
+// вклад байта, за которым идут ещё k байт
+constexpr std::array<std::array<uint32_t, 256>, 8> makeCrc32Tables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int bit = 0; bit < 8; ++bit) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        tables[0][i] = c;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (size_t i = 0; i < 256; ++i)
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+    }
+    return tables;
+}
+
+constexpr std::array<std::array<uint32_t, 256>, 8> kCrc32Tables = makeCrc32Tables();
+
+inline uint32_t crc32(const char* data, size_t size) {
+    const auto& t = kCrc32Tables;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint32_t low = getU32(data) ^ crc;
+        uint32_t high = getU32(data + 4);
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+    }
+    for (; size > 0; ++data, --size)
+        crc = t[0][(crc ^ static_cast<uint8_t>(*data)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Данные компактной версии до сжатия
+std::string encodeCompactBody(const SaveData& save) {
+    std::vector<std::string_view> dictionary;
+    std::unordered_map<std::string_view, uint64_t> codes;
+    auto code = [&](const std::string& text) {
+        auto [it, added] = codes.try_emplace(text, dictionary.size());
+        if (added) dictionary.push_back(text);
+        return it->second;
+    };
+    std::vector<uint64_t> items;
+    items.reserve(save.items.size());
+    uint64_t name = code(save.name);
+    for (const auto& item : save.items) items.push_back(code(item));
+
+    std::string body;
+    appendVarint(body, dictionary.size());
+    for (std::string_view text : dictionary) {
+        appendVarint(body, text.size());
+        body += text;
+    }
+    for (int stat : {save.hp, save.attackPower, save.defense, save.level, save.experience}) appendVarint(body, zigzag(stat));
+    appendVarint(body, name);
+    appendVarint(body, items.size());
+    for (uint64_t item : items) appendVarint(body, item);
+    return body;
+}
+
+// Собирает файл сохранения целиком: заголовок и данные
+std::string encodeSave(const SaveData& save, SaveEncoding encoding = SaveEncoding::Plain) {
+    uint16_t version = encoding == SaveEncoding::Compact ? kSaveCompactVersion : kSavePlainVersion;
+    std::string image;
+    image.append(kSaveMagic, 4);
+    image += static_cast<char>(version & 0xFF);
+    image += static_cast<char>(version >> 8);
+    image.append(2, '\0');
+    putU32(image, 0);   // длина и CRC, заполняются в конце
+    putU32(image, 0);
+
+    if (encoding == SaveEncoding::Compact) {
+        std::string body = encodeCompactBody(save);
+        for (size_t at = 0; at < body.size(); at += kCompressBlockBytes)
+            appendFrame(image, std::string_view(body).substr(at, kCompressBlockBytes));
+    } else {
+        size_t size = kSaveHeaderBytes + 5 * 4 + 4 + save.name.size() + 4;
+        for (const auto& item : save.items) size += 4 + item.size();
+        image.reserve(size);
+        for (int stat : {save.hp, save.attackPower, save.defense, save.level, save.experience})
+            putU32(image, static_cast<uint32_t>(stat));
+        putU32(image, static_cast<uint32_t>(save.name.size()));
+        image += save.name;
+        putU32(image, static_cast<uint32_t>(save.items.size()));
+        for (const auto& item : save.items) {
+            putU32(image, static_cast<uint32_t>(item.size()));
+            image += item;
+        }
+    }
+
+    std::string tail;
+    putU32(tail, static_cast<uint32_t>(image.size() - kSaveHeaderBytes));
+    putU32(tail, crc32(image.data() + kSaveHeaderBytes, image.size() - kSaveHeaderBytes));
+    image.replace(8, 8, tail);
+    return image;
+}
+
+bool isBinarySave(const char* data, size_t size) {
+    return size >= 4 && std::memcmp(data, kSaveMagic, 4) == 0;
+}
+
+// Проверяет заголовок и контрольную сумму и разбирает данные;
+// любое несоответствие - исключение
+SaveData decodeSave(const char* data, size_t size) {
+    auto corrupt = [](const char* what) { return std::runtime_error(std::string("Ошибка загрузки: ") + what); };
+    if (size < kSaveHeaderBytes || !isBinarySave(data, size)) throw corrupt("не файл сохранения");
+    uint16_t version = static_cast<uint16_t>(static_cast<uint8_t>(data[4]) | static_cast<uint8_t>(data[5]) << 8);
+    if (version != kSavePlainVersion && version != kSaveCompactVersion) throw corrupt("неизвестная версия формата");
+    if (getU32(data + 8) != size - kSaveHeaderBytes) throw corrupt("неверная длина");
+    if (getU32(data + 12) != crc32(data + kSaveHeaderBytes, size - kSaveHeaderBytes))
+        throw corrupt("не совпадает контрольная сумма");
+
+    const char* p = data + kSaveHeaderBytes;
+    const char* end = data + size;
+    if (version == kSaveCompactVersion) {
+        // Кадры разжимаются по очереди в одно тело, затем оно разбирается
+        std::string body;
+        while (p != end) {
+            if (!readFrame(p, end, body)) throw corrupt("повреждены сжатые данные");
+        }
+        const char* q = body.data();
+        const char* bodyEnd = q + body.size();
+        auto number = [&]() {
+            uint64_t value = 0;
+            if (!readVarint(q, bodyEnd, value)) throw corrupt("данные оборваны");
+            return value;
+        };
+        uint64_t words = number();
+        if (words > body.size()) throw corrupt("неверный словарь");
+        std::vector<std::string> dictionary(words);
+        for (auto& word : dictionary) {
+            uint64_t length = number();
+            if (length > static_cast<uint64_t>(bodyEnd - q)) throw corrupt("данные оборваны");
+            word.assign(q, length);
+            q += length;
+        }
+        auto word = [&]() -> const std::string& {
+            uint64_t index = number();
+            if (index >= dictionary.size()) throw corrupt("неверный номер строки");
+            return dictionary[index];
+        };
+
+        SaveData save;
+        for (int* stat : {&save.hp, &save.attackPower, &save.defense, &save.level, &save.experience})
+            *stat = static_cast<int>(unzigzag(number()));
+        save.name = word();
+        uint64_t count = number();
+        if (count > static_cast<uint64_t>(bodyEnd - q)) throw corrupt("неверное число предметов");
+        save.items.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) save.items.push_back(word());
+        if (q != bodyEnd) throw corrupt("лишние данные");
+        return save;
+    }
+
+    auto u32 = [&]() {
+        if (end - p < 4) throw corrupt("данные оборваны");
+        uint32_t value = getU32(p);
+        p += 4;
+        return value;
+    };
+    auto text = [&]() {
+        uint32_t length = u32();
+        if (static_cast<size_t>(end - p) < length) throw corrupt("данные оборваны");
+        std::string value(p, length);
+        p += length;
+        return value;
+    };
+
+    SaveData save;
+    for (int* stat : {&save.hp, &save.attackPower, &save.defense, &save.level, &save.experience})
+        *stat = static_cast<int32_t>(u32());
+    save.name = text();
+    uint32_t count = u32();
+    if (count > static_cast<size_t>(end - p) / 4) throw corrupt("неверное число предметов");
+    save.items.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) save.items.push_back(text());
+    if (p != end) throw corrupt("лишние данные");
+    return save;
+}
+
+// Прежний текстовый формат: поля по строкам, имя - одно слово.
+// Читается для миграции старых сохранений, пишется только для сравнения.
+SaveData readTextSave(std::istream& in) {
+    SaveData save;
+    size_t invSize = 0;
+    std::string item;
+    in >> save.name >> save.hp >> save.attackPower >> save.defense >> save.level >> save.experience >> invSize;
+    if (!in) throw std::runtime_error("Ошибка загрузки!");
+    std::getline(in, item); // очистка строки
+    for (size_t i = 0; i < invSize; ++i) {
+        std::getline(in, item);
+        save.items.push_back(item);
+    }
+    return save;
+}
+
+void writeTextSave(std::ostream& out, const SaveData& save) {
+    out << save.name << "\n" << save.hp << "\n" << save.attackPower << "\n" << save.defense << "\n"
+        << save.level << "\n" << save.experience << "\n";
+    out << save.items.size() << "\n";
+    for (const auto& item : save.items) out << item << "\n";
+}
+
+// Содержимое файла только для чтения. Большие файлы отображаются в память;
+// маленькие читаются одним read(), потому что mmap + munmap + отказы
+// страниц обходятся дороже самого чтения. Порог - по замеру open + чтение
+// всех байт + close на прогретом кэше (x86-64, Linux): read быстрее до
+// 64 КБ (7 мкс против 15), при 256 КБ уже mmap (20 мкс против 25), при
+// 1 МБ - вдвое. Компактные сохранения (~100 байт) и обычные с парой сотен
+// предметов идут через read; обычное сохранение с десятками тысяч
+// трофеев (600+ КБ) и длинный журнал дельт - через mmap.
+class MappedFile {
+private:
+    static constexpr size_t kMapThreshold = 256 * 1024;
+
+    const char* bytes = nullptr;
+    size_t length = 0;
+    std::string contents;
+#ifndef _WIN32
+    void* mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Ошибка загрузки!");
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Ошибка загрузки!");
+        }
+        length = static_cast<size_t>(info.st_size);
+        bool ok = true;
+        if (length >= kMapThreshold) {
+            mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) mapping = nullptr;
+            ok = mapping != nullptr;
+            bytes = static_cast<const char*>(mapping);
+        } else {
+            contents.resize(length);
+            size_t done = 0;
+            while (ok && done < length) {
+                ssize_t got = ::read(fd, contents.data() + done, length - done);
+                ok = got > 0;
+                if (ok) done += static_cast<size_t>(got);
+            }
+            bytes = contents.data();
+        }
+        ::close(fd);
+        if (!ok) throw std::runtime_error("Ошибка загрузки!");
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Ошибка загрузки!");
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = contents.data();
+        length = contents.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping) munmap(mapping, length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Пишет готовый образ сохранения одним вызовом write во временный файл
+// и подменяет им старый, так что сбой не оставит половину сохранения
+void writeSaveImage(const std::string& path, const std::string& image) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Ошибка сохранения!");
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out) throw std::runtime_error("Ошибка сохранения!");
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) throw std::runtime_error("Ошибка сохранения!");
+}
+
+void writeSaveFile(const std::string& path, const SaveData& save, SaveEncoding encoding = SaveEncoding::Plain) {
+    writeSaveImage(path, encodeSave(save, encoding));
+}
+
+// Читает сохранение любого формата: двоичное проверяется и разбирается
+// прямо из прочитанных байт, старое текстовое - разбирается по-старому
+SaveData readSaveFile(const std::string& path) {
+    MappedFile file(path);
+    if (isBinarySave(file.data(), file.size())) return decodeSave(file.data(), file.size());
+    std::istringstream text(std::string(file.data(), file.size()));
+    return readTextSave(text);
+}
+
+// ---------- Инкрементальные сохранения ----------
+// Поля персонажа, изменившиеся с последнего сохранения (битовая маска)
+enum SaveField : uint8_t {
+    kSaveName = 1 << 0,
+    kSaveHp = 1 << 1,
+    kSaveAttack = 1 << 2,
+    kSaveDefense = 1 << 3,
+    kSaveLevel = 1 << 4,
+    kSaveExperience = 1 << 5
+};
+
+// Дельта: новые значения изменившихся полей и изменения инвентаря по порядку
+struct SaveDelta {
+    uint8_t fields = 0;
+    SaveData values;   // значимы только поля из fields; values.items не используется
+    std::vector<InventoryChange<std::string>> items;
+};
+
+// Журнал дельт лежит рядом со снимком (путь.journal):
+//   заголовок: "L9DJ", u32 CRC снимка, к которому относятся дельты
+//   запись:    u32 длина данных, u32 CRC-32 данных, данные:
+//              u8 маска полей, [u32 длина имени, имя], [i32 за каждое поле по порядку
+//              битов], u32 число изменений инвентаря, у каждого u8 (0 - убран,
+//              1 - добавлен, 2 - добавлено несколько), u32 длина, байты предмета,
+//              [u32 сколько добавлено - только для 2]
+// Журнал от другого снимка не применяется; запись, оборванная при сбое,
+// и всё после неё отбрасываются.
+constexpr char kJournalMagic[4] = {'L', '9', 'D', 'J'};
+
+std::string journalPath(const std::string& savePath) {
+    return savePath + ".journal";
+}
+
+std::string encodeJournalHeader(uint32_t snapshotCrc) {
+    std::string header(kJournalMagic, 4);
+    putU32(header, snapshotCrc);
+    return header;
+}
+
+std::string encodeDelta(const SaveDelta& delta) {
+    std::string record(8, '\0');   // длина и CRC, заполняются в конце
+    record += static_cast<char>(delta.fields);
+    if (delta.fields & kSaveName) {
+        putU32(record, static_cast<uint32_t>(delta.values.name.size()));
+        record += delta.values.name;
+    }
+    const int stats[] = {delta.values.hp, delta.values.attackPower, delta.values.defense,
+                         delta.values.level, delta.values.experience};
+    for (int bit = 0; bit < 5; ++bit) {
+        if (delta.fields & (kSaveHp << bit)) putU32(record, static_cast<uint32_t>(stats[bit]));
+    }
+    putU32(record, static_cast<uint32_t>(delta.items.size()));
+    for (const auto& change : delta.items) {
+        bool several = change.added && change.count > 1;
+        record += static_cast<char>(several ? 2 : change.added ? 1 : 0);
+        putU32(record, static_cast<uint32_t>(change.item.size()));
+        record += change.item;
+        if (several) putU32(record, static_cast<uint32_t>(change.count));
+    }
+
+    std::string prefix;
+    putU32(prefix, static_cast<uint32_t>(record.size() - 8));
+    putU32(prefix, crc32(record.data() + 8, record.size() - 8));
+    record.replace(0, 8, prefix);
+    return record;
+}
+
+// Применяет данные одной дельты к состоянию; false - запись повреждена
+bool applyDelta(SaveData& save, const char* p, const char* end) {
+    auto u32 = [&](uint32_t& value) {
+        if (end - p < 4) return false;
+        value = getU32(p);
+        p += 4;
+        return true;
+    };
+    auto text = [&](std::string& value) {
+        uint32_t length = 0;
+        if (!u32(length) || static_cast<size_t>(end - p) < length) return false;
+        value.assign(p, length);
+        p += length;
+        return true;
+    };
+
+    if (p == end) return false;
+    uint8_t fields = static_cast<uint8_t>(*p++);
+    SaveData next = save;
+    if ((fields & kSaveName) && !text(next.name)) return false;
+    int* stats[] = {&next.hp, &next.attackPower, &next.defense, &next.level, &next.experience};
+    for (int bit = 0; bit < 5; ++bit) {
+        uint32_t value = 0;
+        if (!(fields & (kSaveHp << bit))) continue;
+        if (!u32(value)) return false;
+        *stats[bit] = static_cast<int32_t>(value);
+    }
+    uint32_t count = 0;
+    if (!u32(count)) return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (p == end) return false;
+        uint8_t kind = static_cast<uint8_t>(*p++);
+        std::string item;
+        uint32_t added = 1;
+        if (kind > 2 || !text(item) || (kind == 2 && !u32(added))) return false;
+        // Так же, как Inventory: добавление в конец, удаление - всех равных
+        if (kind != 0) next.items.insert(next.items.end(), added, item);
+        else next.items.erase(std::remove(next.items.begin(), next.items.end(), item), next.items.end());
+    }
+    if (p != end) return false;
+    save = std::move(next);
+    return true;
+}
+
+// Дописывает уже закодированные данные в конец журнала одной записью
+void appendJournal(const std::string& path, const std::string& bytes, bool truncate) {
+    std::ofstream out(path, std::ios::binary | (truncate ? std::ios::trunc : std::ios::app));
+    if (!out) throw std::runtime_error("Ошибка сохранения!");
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) throw std::runtime_error("Ошибка сохранения!");
+}
+
+// Снимок и применённый к нему журнал
+struct LoadedSave {
+    SaveData data;
+    bool binary = false;       // false - старое текстовое сохранение, журнала у него нет
+    uint32_t snapshotCrc = 0;
+    size_t deltas = 0;         // сколько дельт применено
+};
+
+LoadedSave readSaveWithJournal(const std::string& path) {
+    LoadedSave loaded;
+    {
+        MappedFile file(path);
+        loaded.binary = isBinarySave(file.data(), file.size());
+        if (!loaded.binary) {
+            std::istringstream text(std::string(file.data(), file.size()));
+            loaded.data = readTextSave(text);
+            return loaded;
+        }
+        loaded.data = decodeSave(file.data(), file.size());
+        loaded.snapshotCrc = getU32(file.data() + 12);
+    }
+
+    if (!std::filesystem::exists(journalPath(path))) return loaded;
+    MappedFile journal(journalPath(path));
+    const char* p = journal.data();
+    const char* end = p + journal.size();
+    if (journal.size() < 8 || std::memcmp(p, kJournalMagic, 4) != 0 || getU32(p + 4) != loaded.snapshotCrc)
+        return loaded;   // журнал от другого снимка
+    p += 8;
+    while (end - p >= 8) {
+        uint32_t length = getU32(p);
+        uint32_t crc = getU32(p + 4);
+        if (static_cast<size_t>(end - p - 8) < length || crc32(p + 8, length) != crc) break;
+        if (!applyDelta(loaded.data, p + 8, p + 8 + length)) break;
+        p += 8 + length;
+        ++loaded.deltas;
+    }
+    return loaded;
+}
+
+// ---------- Сервис сохранений ----------
+// Сохранения многих игроков из разных потоков собираются в пачки и пишутся
+// в общий журнал: одна запись и один fdatasync на пачку вместо открытия,
+// записи и закрытия файла на каждое сохранение (групповая фиксация).
+// Запись журнала: u32 длина, u32 CRC-32 остального, u16 длина ключа, ключ,
+// образ сохранения (encodeSave). Актуальна последняя запись ключа.
+class SaveService {
+public:
+    struct Stats {
+        uint64_t saves = 0;
+        uint64_t batches = 0;
+    };
+
+private:
+    static constexpr size_t kRecordHeaderBytes = 10;
+    static constexpr uintmax_t kCompactSlack = 1 << 20;   // байт мусора, после которых журнал сжимается
+
+    struct Request {
+        std::string key;
+        std::string record;
+        std::promise<void> done;
+    };
+
+    std::string path;
+    std::FILE* file = nullptr;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Request> pending;
+    std::unordered_map<std::string, std::string> latest;   // ключ -> последняя записанная запись
+    uintmax_t fileBytes = 0;
+    uintmax_t liveBytes = 0;
+    Stats stats;
+    bool stopping = false;
+    std::thread worker;
+
+    static std::string encodeRecord(const std::string& key, const SaveData& save) {
+        std::string image = encodeSave(save, saveEncoding);
+        std::string record(kRecordHeaderBytes, '\0');
+        record[8] = static_cast<char>(key.size() & 0xFF);
+        record[9] = static_cast<char>(key.size() >> 8);
+        record += key;
+        record += image;
+        std::string prefix;
+        putU32(prefix, static_cast<uint32_t>(record.size() - 8));
+        putU32(prefix, crc32(record.data() + 8, record.size() - 8));
+        record.replace(0, 8, prefix);
+        return record;
+    }
+
+    static std::string_view recordKey(const std::string& record) {
+        size_t length = static_cast<uint8_t>(record[8]) | static_cast<size_t>(static_cast<uint8_t>(record[9])) << 8;
+        return std::string_view(record).substr(kRecordHeaderBytes, length);
+    }
+
+    // Читает журнал, оставшийся с прошлого запуска; хвост после первой
+    // оборванной или испорченной записи отрезается
+    void replay() {
+        std::string data;
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return;
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        size_t offset = 0;
+        while (data.size() - offset >= kRecordHeaderBytes) {
+            uint32_t length = getU32(data.data() + offset);
+            if (length < 2 || data.size() - offset - 8 < length ||
+                crc32(data.data() + offset + 8, length) != getU32(data.data() + offset + 4))
+                break;
+            std::string record = data.substr(offset, 8 + length);
+            if (recordKey(record).size() + kRecordHeaderBytes > record.size()) break;
+            index(std::move(record));
+            offset += 8 + length;
+        }
+        fileBytes = offset;
+        if (offset != data.size()) std::filesystem::resize_file(path, offset);
+    }
+
+    void index(std::string record) {
+        std::string key(recordKey(record));
+        liveBytes += record.size();
+        auto [it, inserted] = latest.try_emplace(std::move(key));
+        if (!inserted) liveBytes -= it->second.size();
+        it->second = std::move(record);
+    }
+
+    bool writeDurable(std::FILE* target, const std::string& data) {
+        if (std::fwrite(data.data(), 1, data.size(), target) != data.size()) return false;
+        if (std::fflush(target) != 0) return false;
+#ifndef _WIN32
+        if (fdatasync(fileno(target)) != 0) return false;
+#endif
+        return true;
+    }
+
+    // Пачка не записалась: хвост журнала мог остаться с частью записи, и
+    // следующая пачка легла бы за ним (а replay отрезал бы её вместе с
+    // мусором). Закрываем файл вместе с недописанным буфером, отрезаем
+    // журнал по последней целой записи и открываем заново. Если и это не
+    // вышло, сервис больше ничего не принимает: file остаётся пустым.
+    void rollback() {
+        if (file) std::fclose(file);
+        file = nullptr;
+        std::error_code error;
+        std::filesystem::resize_file(path, fileBytes, error);
+        if (!error) file = std::fopen(path.c_str(), "ab");
+    }
+
+    // После rename запись каталога тоже должна дойти до диска, иначе после
+    // сбоя питания журнал может оказаться старым
+    void syncDirectory() {
+#ifndef _WIN32
+        std::filesystem::path dir = std::filesystem::path(path).parent_path();
+        int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        fsync(fd);
+        ::close(fd);
+#endif
+    }
+
+    // Переписывает журнал, оставляя по одной записи на ключ
+    void compact() {
+        std::string data;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            data.reserve(liveBytes);
+            for (const auto& entry : latest) data += entry.second;
+        }
+        std::string temporary = path + ".tmp";
+        std::FILE* out = std::fopen(temporary.c_str(), "wb");
+        if (!out) return;
+        bool written = writeDurable(out, data);
+        std::fclose(out);
+        std::error_code error;
+        if (written) std::filesystem::rename(temporary, path, error);
+        if (!written || error) {
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+        syncDirectory();
+        if (file) std::fclose(file);
+        file = std::fopen(path.c_str(), "ab");   // не открылся - дальше пачки отклоняются
+        fileBytes = data.size();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break;   // остановка, и очередь уже пуста
+
+            std::vector<Request> batch;
+            batch.swap(pending);
+            lock.unlock();
+            // Всё, что накопилось, пока писалась прошлая пачка, уходит одной записью
+            std::string data;
+            for (const Request& request : batch) data += request.record;
+            bool written = file && writeDurable(file, data);
+
+            lock.lock();
+            if (written) {
+                for (Request& request : batch) index(std::move(request.record));
+                fileBytes += data.size();
+                stats.saves += batch.size();
+                ++stats.batches;
+            } else if (file) {
+                rollback();
+            }
+            bool compactNow = written && fileBytes > 2 * liveBytes + kCompactSlack;
+            lock.unlock();
+            for (Request& request : batch) {
+                if (written) request.done.set_value();
+                else request.done.set_exception(std::make_exception_ptr(std::runtime_error("Ошибка сохранения!")));
+            }
+            if (compactNow) compact();
+            lock.lock();
+        }
+    }
+
+public:
+    explicit SaveService(std::string journalFile) : path(std::move(journalFile)) {
+        replay();
+        file = std::fopen(path.c_str(), "ab");
+        if (!file) throw std::runtime_error("Ошибка сохранения!");
+        worker = std::thread(&SaveService::run, this);
+    }
+
+    // Дописывает очередь и закрывает журнал
+    ~SaveService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        if (file) std::fclose(file);
+    }
+
+    SaveService(const SaveService&) = delete;
+    SaveService& operator=(const SaveService&) = delete;
+
+    // Кодирует сохранение в потоке вызывающего и ставит в ближайшую пачку;
+    // future готов, когда пачка надёжно записана на диск
+    std::future<void> submit(const std::string& key, const SaveData& save) {
+        if (key.size() > 0xFFFF) throw std::runtime_error("Ошибка сохранения!");
+        Request request{key, encodeRecord(key, save), {}};
+        std::future<void> done = request.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(request));
+        }
+        wake.notify_one();
+        return done;
+    }
+
+    // Последнее надёжно записанное сохранение ключа
+    SaveData load(const std::string& key) {
+        std::string record;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = latest.find(key);
+            if (it == latest.end()) throw std::runtime_error("Ошибка загрузки: сохранение не найдено");
+            record = it->second;
+        }
+        size_t offset = kRecordHeaderBytes + key.size();
+        return decodeSave(record.data() + offset, record.size() - offset);
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+// ---------- Класс Monster ----------
+class Character;
+
+// Итог получения урона: смерть - обычный результат удара, а не исключение
+enum class CombatOutcome { Alive, Died };
+
+// Таблица архетипов монстров; новый монстр добавляется одной строкой:
+//   X(идентификатор, имя, HP, атака, защита)
+#define MONSTER_ARCHETYPES(X)          \
+    X(Goblin,   "Гоблин", 30,  5,  2)  \
+    X(Dragon,   "Дракон", 100, 20, 10) \
+    X(Skeleton, "Скелет", 40,  8,  4)
+
+enum class MonsterType : uint8_t {
+#define MONSTER_ENUM(id, name, hp, attack, defense) id,
+    MONSTER_ARCHETYPES(MONSTER_ENUM)
+#undef MONSTER_ENUM
+};
+
+struct MonsterArchetype {
+    std::string_view name;
+    int hp;
+    int attackPower;
+    int defense;
+};
+
+constexpr MonsterArchetype kMonsterArchetypes[] = {
+#define MONSTER_ROW(id, name, hp, attack, defense) {name, hp, attack, defense},
+    MONSTER_ARCHETYPES(MONSTER_ROW)
+#undef MONSTER_ROW
+};
+
+constexpr uint32_t kMonsterTypeCount = static_cast<uint32_t>(std::size(kMonsterArchetypes));
+
+// Монстр - компактное значение: тип (индекс в таблице архетипов) и текущее HP.
+// Всё постоянное берётся из таблицы, виртуальных вызовов и кучи нет.
+class Monster {
+private:
+    MonsterType type;
+    int hp;
+
+public:
+    explicit Monster(MonsterType t) : type(t), hp(archetype().hp) {}
+
+    const MonsterArchetype& archetype() const {
+        return kMonsterArchetypes[static_cast<size_t>(type)];
+    }
+
+    CombatOutcome attack(Character& c);
+    void display(std::ostream& out = std::cout) const {
+        out << getName() << " (HP: " << hp << ", ATK: " << getAttack() << ", DEF: " << getDefense() << ")\n";
+    }
+
+    CombatOutcome takeDamage(int dmg) {
+        hp -= dmg;
+        return isDead() ? CombatOutcome::Died : CombatOutcome::Alive;
+    }
+
+    bool isDead() const { return hp <= 0; }
+    MonsterType getType() const { return type; }
+    std::string_view getName() const { return archetype().name; }
+    int getHP() const { return hp; }
+    int getAttack() const { return archetype().attackPower; }
+    int getDefense() const { return archetype().defense; }
+};
+
+// ---------- Класс Character ----------
+class Character {
+private:
+    std::string name;
+    int hp;
+    int attackPower;
+    int defense;
+    int level;
+    int experience;
+    StackedInventory<std::string> inventory;   // трофеи копятся тысячами, храним стопками
+    EventLog events;
+
+    // Инкрементальное сохранение: что изменилось и куда записан снимок
+    uint8_t dirtyFields = 0;
+    std::string snapshotPath;    // пусто - снимка этой сессии ещё нет
+    uint32_t snapshotCrc = 0;
+    size_t journalDeltas = 0;
+
+    void markSaved(const std::string& path, uint32_t crc, size_t deltas) {
+        snapshotPath = path;
+        snapshotCrc = crc;
+        journalDeltas = deltas;
+        dirtyFields = 0;
+        inventory.clearChanges();
+    }
+
+public:
+    static constexpr size_t kCompactEvery = 16;   // дельт в журнале до нового снимка
+
+    Character(std::string n, const std::string& logFile = "game_log.bin")
+        : name(n), hp(100), attackPower(10), defense(5), level(1), experience(0), events(logFile) {}
+
+    // Журнал пишется сегментами logFile.000001, logFile.000002, ...
+    Character(std::string n, const std::string& logFile, const LogSegments& segments)
+        : name(n), hp(100), attackPower(10), defense(5), level(1), experience(0), events(logFile, segments) {}
+
+    CombatOutcome attackMonster(Monster& m) {
+        int damage = std::max(0, attackPower - m.getDefense());
+        events.record<LogEvent::Attack>(name, m.getName(), damage);
+        return m.takeDamage(damage);
+    }
+
+    CombatOutcome takeDamage(int dmg) {
+        int realDmg = std::max(0, dmg - defense);
+        hp -= realDmg;
+        dirtyFields |= kSaveHp;
+        events.record<LogEvent::TakeDamage>(name, {}, realDmg);
+        return hp <= 0 ? CombatOutcome::Died : CombatOutcome::Alive;
+    }
+
+    const std::string& getName() const { return name; }
+
+    void heal(int amount) {
+        hp += amount;
+        if (hp > 100) hp = 100;
+        dirtyFields |= kSaveHp;
+        events.record<LogEvent::Heal>(name, {}, amount);
+    }
+
+    void gainExperience(int exp) {
+        experience += exp;
+        dirtyFields |= kSaveExperience;
+        if (experience >= 100) {
+            level++;
+            experience = 0;
+            dirtyFields |= kSaveLevel;
+            events.record<LogEvent::LevelUp>(name, {}, level);
+        }
+    }
+
+    void display(std::ostream& out = std::cout) const {
+        out << name << " (HP: " << hp << ", ATK: " << attackPower
+            << ", DEF: " << defense << ", LVL: " << level << ", EXP: " << experience << ")\n";
+        inventory.display(out);
+    }
+
+    void addItem(const std::string& item) {
+        inventory.addItem(item);
+        events.record<LogEvent::ItemGained>(name, item);
+    }
+
+    // Дожидается, пока журнал персонажа окажется в файле
+    void flushLog() {
+        events.flush();
+    }
+
+    SaveData snapshot() const {
+        return {name, hp, attackPower, defense, level, experience, inventory.getItems()};
+    }
+
+    void restore(SaveData save) {
+        name = std::move(save.name);
+        hp = save.hp;
+        attackPower = save.attackPower;
+        defense = save.defense;
+        level = save.level;
+        experience = save.experience;
+        inventory = StackedInventory<std::string>();
+        for (auto& item : save.items) inventory.addItem(std::move(item));
+        dirtyFields = kSaveName | kSaveHp | kSaveAttack | kSaveDefense | kSaveLevel | kSaveExperience;
+    }
+
+    // Полный снимок; журнал дельт при этом начинается заново
+    void save(const std::string& filename) {
+        std::string image = encodeSave(snapshot(), saveEncoding);
+        writeSaveImage(filename, image);
+        uint32_t crc = getU32(image.data() + 12);
+        appendJournal(journalPath(filename), encodeJournalHeader(crc), true);
+        markSaved(filename, crc, 0);
+        events.record<LogEvent::Saved>(name);
+    }
+
+    // Автосохранение: в журнал дописываются только изменения с прошлого
+    // раза, каждые kCompactEvery дельт журнал сворачивается в новый снимок
+    void saveIncremental(const std::string& filename) {
+        if (snapshotPath != filename || journalDeltas >= kCompactEvery) {
+            save(filename);
+            return;
+        }
+        if (dirtyFields == 0 && !inventory.hasPendingChanges()) return;
+
+        SaveDelta delta;
+        delta.fields = dirtyFields;
+        delta.values.hp = hp;
+        delta.values.attackPower = attackPower;
+        delta.values.defense = defense;
+        delta.values.level = level;
+        delta.values.experience = experience;
+        if (dirtyFields & kSaveName) delta.values.name = name;
+        delta.items = inventory.pendingChanges();
+        appendJournal(journalPath(filename), encodeDelta(delta), false);
+        markSaved(filename, snapshotCrc, journalDeltas + 1);
+        events.record<LogEvent::Saved>(name);
+    }
+
+    // Сохранение через общий журнал сервиса: future готов, когда пачка,
+    // в которую попало сохранение, надёжно записана
+    std::future<void> save(SaveService& service, const std::string& slot) {
+        std::future<void> done = service.submit(slot, snapshot());
+        events.record<LogEvent::Saved>(name);
+        return done;
+    }
+
+    void load(SaveService& service, const std::string& slot) {
+        restore(service.load(slot));
+        markSaved("", 0, 0);   // своего снимка нет, saveIncremental начнёт с полного
+        events.record<LogEvent::Loaded>(name);
+    }
+
+    // Принимает и двоичные (снимок + журнал), и старые текстовые сохранения;
+    // состояние меняется только после успешной проверки снимка
+    void load(const std::string& filename) {
+        LoadedSave loaded = readSaveWithJournal(filename);
+        restore(std::move(loaded.data));
+        if (loaded.binary) markSaved(filename, loaded.snapshotCrc, loaded.deltas);
+        else markSaved("", 0, 0);
+        events.record<LogEvent::Loaded>(name);
+    }
+};
+
+// Реализация атаки монстра на персонажа
+CombatOutcome Monster::attack(Character& c) {
+    return c.takeDamage(getAttack());
+}
+
+// ---------- Оценка исходов боёв методом Монте-Карло ----------
+// Параметры персонажа для безголовых боёв (по умолчанию - новый персонаж)
+struct CharacterBuild {
+    int hp = 100;
+    int attackPower = 10;
+    int defense = 5;
+};
+
+// Модификаторы из lab1.3. По умолчанию выключены, и тогда бой идёт
+// ровно по правилам Game::fight
+struct CombatRules {
+    int critChance = 0;       // шанс крита персонажа, %
+    int critMultiplier = 2;
+    int poisonChance = 0;     // шанс ядовитой атаки монстра, %
+    int poisonBonus = 5;
+    int flameChance = 0;      // шанс огненного удара монстра, %
+    int flameBonus = 15;
+};
+
+struct FightResult {
+    bool won;
+    int rounds;
+    int hpLeft;
+    int xpGained;
+};
+
+// Один бой без вывода, логов и исключений - та же последовательность ударов,
+// что в Game::fight. Если никто никого не может ранить, бой обрывается на maxRounds
+FightResult simulateFight(const CharacterBuild& hero, const Monster& monster,
+                          const CombatRules& rules, RollStream& rolls, int maxRounds) {
+    int heroHp = hero.hp;
+    int monsterHp = monster.getHP();
+    int rounds = 0;
+
+    while (monsterHp > 0 && rounds < maxRounds) {
+        ++rounds;
+        int damage = std::max(0, hero.attackPower - monster.getDefense());
+        if (damage > 0 && rules.critChance > 0 && rolls.percent() < rules.critChance)
+            damage *= rules.critMultiplier;
+        monsterHp -= damage;
+        if (monsterHp <= 0) break;
+
+        int received = monster.getAttack() - hero.defense;
+        if (rules.flameChance > 0 && rolls.percent() < rules.flameChance)
+            received += rules.flameBonus;
+        if (received > 0 && rules.poisonChance > 0 && rolls.percent() < rules.poisonChance)
+            received += rules.poisonBonus;
+        heroHp -= std::max(0, received);
+        if (heroHp <= 0) return {false, rounds, 0, 0};
+    }
+    bool won = monsterHp <= 0;
+    return {won, rounds, heroHp, won ? 50 : 0};
+}
+
+// Потоковое среднее и дисперсия (Welford), сливаемые между потоками
+struct RunningStat {
+    uint64_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x) {
+        ++n;
+        double delta = x - mean;
+        mean += delta / static_cast<double>(n);
+        m2 += delta * (x - mean);
+    }
+
+    void merge(const RunningStat& other) {
+        if (other.n == 0) return;
+        uint64_t total = n + other.n;
+        double delta = other.mean - mean;
+        mean += delta * static_cast<double>(other.n) / static_cast<double>(total);
+        m2 += other.m2 + delta * delta * static_cast<double>(n) * static_cast<double>(other.n) / static_cast<double>(total);
+        n = total;
+    }
+
+    // Полуширина 95% доверительного интервала для среднего
+    double halfWidth() const {
+        if (n < 2) return std::numeric_limits<double>::infinity();
+        return 1.96 * std::sqrt(m2 / static_cast<double>(n - 1) / static_cast<double>(n));
+    }
+};
+
+struct Interval {
+    double mean;
+    double low;
+    double high;
+};
+
+struct EstimatorConfig {
+    uint64_t seed = 1;
+    uint64_t maxFights = 10000000;
+    uint64_t batchSize = 16384;       // боёв в одной пачке (одна пачка - один поток бросков)
+    double winPrecision = 0.001;      // целевая полуширина интервала для вероятности победы
+    double relativePrecision = 0.001; // целевая относительная полуширина для средних
+    unsigned threads = 0;             // 0 - все ядра
+    int maxRounds = 10000;
+};
+
+struct BattleEstimate {
+    uint64_t fights = 0;
+    bool converged = false;
+    Interval winProbability{};
+    Interval rounds{};
+    Interval hpLeft{};
+    Interval xpGained{};
+    std::vector<uint64_t> roundHistogram;   // roundHistogram[r] - число боёв длиной r раундов
+};
+
+// Итоги одной пачки боёв
+struct BatchStats {
+    uint64_t wins = 0;
+    RunningStat rounds, hpLeft, xpGained;
+    std::vector<uint64_t> roundHistogram;
+
+    void merge(const BatchStats& other) {
+        wins += other.wins;
+        rounds.merge(other.rounds);
+        hpLeft.merge(other.hpLeft);
+        xpGained.merge(other.xpGained);
+        if (roundHistogram.size() < other.roundHistogram.size())
+            roundHistogram.resize(other.roundHistogram.size());
+        for (size_t r = 0; r < other.roundHistogram.size(); ++r)
+            roundHistogram[r] += other.roundHistogram[r];
+    }
+};
+
+// Интервал Уилсона для доли побед
+Interval wilsonInterval(uint64_t wins, uint64_t n) {
+    if (n == 0) return {0.0, 0.0, 1.0};
+    const double z = 1.96;
+    double p = static_cast<double>(wins) / static_cast<double>(n);
+    double denom = 1.0 + z * z / static_cast<double>(n);
+    double center = (p + z * z / (2.0 * static_cast<double>(n))) / denom;
+    double half = z * std::sqrt(p * (1.0 - p) / static_cast<double>(n) + z * z / (4.0 * static_cast<double>(n) * static_cast<double>(n))) / denom;
+    return {p, std::max(0.0, center - half), std::min(1.0, center + half)};
+}
+
+Interval meanInterval(const RunningStat& s) {
+    double half = s.n < 2 ? 0.0 : s.halfWidth();
+    return {s.mean, s.mean - half, s.mean + half};
+}
+
+bool precise(const RunningStat& s, double relative) {
+    if (s.n < 2) return false;
+    return s.m2 == 0.0 || s.halfWidth() <= relative * std::abs(s.mean);
+}
+
+// Прогоняет бои персонажа против монстра на всех ядрах, пока интервалы не
+// сузятся до заданной точности или не кончится maxFights. Пачка k всегда
+// использует поток бросков k, а итоги сливаются по порядку пачек, поэтому
+// результат не зависит от числа потоков и повторяется при перезапуске.
+BattleEstimate estimateBattle(const CharacterBuild& hero, MonsterType type,
+                              const CombatRules& rules, const EstimatorConfig& config) {
+    const Monster monster(type);
+    unsigned threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    uint64_t totalBatches = (config.maxFights + config.batchSize - 1) / config.batchSize;
+    uint64_t batchesPerWave = static_cast<uint64_t>(threads) * 4;
+
+    BatchStats total;
+    uint64_t fights = 0;
+    bool converged = false;
+
+    for (uint64_t first = 0; first < totalBatches && !converged; first += batchesPerWave) {
+        uint64_t last = std::min(totalBatches, first + batchesPerWave);
+        std::vector<BatchStats> wave(last - first);
+        std::atomic<uint64_t> nextBatch{first};
+
+        auto worker = [&]() {
+            for (uint64_t b = nextBatch++; b < last; b = nextBatch++) {
+                RollStream rolls(config.seed, b);
+                BatchStats& stats = wave[b - first];
+                uint64_t count = std::min(config.batchSize, config.maxFights - b * config.batchSize);
+                for (uint64_t i = 0; i < count; ++i) {
+                    FightResult r = simulateFight(hero, monster, rules, rolls, config.maxRounds);
+                    stats.wins += r.won;
+                    stats.rounds.add(r.rounds);
+                    stats.hpLeft.add(r.hpLeft);
+                    stats.xpGained.add(r.xpGained);
+                    if (stats.roundHistogram.size() <= static_cast<size_t>(r.rounds))
+                        stats.roundHistogram.resize(r.rounds + 1);
+                    ++stats.roundHistogram[r.rounds];
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool) th.join();
+
+        for (const auto& stats : wave) total.merge(stats);
+        fights = total.rounds.n;
+
+        Interval win = wilsonInterval(total.wins, fights);
+        converged = fights > 1 && (win.high - win.low) / 2.0 <= config.winPrecision
+            && precise(total.rounds, config.relativePrecision)
+            && precise(total.hpLeft, config.relativePrecision)
+            && (total.xpGained.mean == 0.0 || precise(total.xpGained, config.relativePrecision));
+    }
+
+    BattleEstimate result;
+    result.fights = fights;
+    result.converged = converged;
+    result.winProbability = wilsonInterval(total.wins, fights);
+    result.rounds = meanInterval(total.rounds);
+    result.hpLeft = meanInterval(total.hpLeft);
+    result.xpGained = meanInterval(total.xpGained);
+    result.roundHistogram = std::move(total.roundHistogram);
+    return result;
+}
 
-class Dragon : public Monster {
-public:
-    Dragon() : Monster("Дракон", 100, 20, 10) {}
-};
+void printEstimate(const std::string& title, const BattleEstimate& e) {
+    auto show = [](const char* label, const Interval& i) {
+        std::cout << "  " << label << ": " << i.mean << " [" << i.low << "; " << i.high << "]\n";
+    };
+    std::cout << title << " (боёв: " << e.fights << (e.converged ? ", точность достигнута" : "") << ")\n";
+    show("Вероятность победы", e.winProbability);
+    show("Раунды", e.rounds);
+    show("Остаток HP", e.hpLeft);
+    show("Получено опыта", e.xpGained);
+    std::cout << "  Распределение раундов:";
+    for (size_t r = 0; r < e.roundHistogram.size(); ++r) {
+        if (e.roundHistogram[r])
+            std::cout << " " << r << ":" << static_cast<double>(e.roundHistogram[r]) / static_cast<double>(e.fights);
+    }
+    std::cout << "\n";
+}
 
-class Skeleton : public Monster {
-public:
-    Skeleton() : Monster("Скелет", 40, 8, 4) {}
+// ---------- Точное распределение исхода дуэли ----------
+// Вместо розыгрыша раунд за раундом считаем вероятности всех состояний
+// (HP персонажа, HP монстра) динамическим программированием. Правила те же,
+// что в simulateFight, поэтому результат - предел оценки Монте-Карло.
+struct DuelDistribution {
+    double winProbability = 0.0;
+    double lossProbability = 0.0;
+    double unresolvedProbability = 0.0;    // бой дошёл до maxRounds
+    double expectedRounds = 0.0;
+    double expectedHpLeft = 0.0;
+    double expectedXp = 0.0;
+    std::vector<double> roundProbability;  // roundProbability[r] - бой закончился на раунде r
+    std::vector<double> hpLeftProbability; // hpLeftProbability[h] - у персонажа осталось h HP
 };
 
-// ---------- Класс Character ----------
-class Character {
-private:
-    std::string name;
-    int hp;
-    int attackPower;
-    int defense;
-    int level;
-    int experience;
-    Inventory<std::string> inventory;
-    Logger<std::string> logger;
+// Один вариант удара: урон и его вероятность
+struct HitBranch {
+    int damage;
+    double probability;
+};
 
-public:
-    Character(std::string n)
-        : name(n), hp(100), attackPower(10), defense(5), level(1), experience(0), logger("game_log.txt") {}
+std::vector<HitBranch> heroHitBranches(const CharacterBuild& hero, const Monster& monster, const CombatRules& rules) {
+    int base = std::max(0, hero.attackPower - monster.getDefense());
+    double crit = std::min(100, std::max(0, rules.critChance)) / 100.0;
+    if (base == 0 || crit == 0.0) return {{base, 1.0}};
+    if (crit == 1.0) return {{base * rules.critMultiplier, 1.0}};
+    return {{base * rules.critMultiplier, crit}, {base, 1.0 - crit}};
+}
 
-    void attackMonster(Monster& m) {
-        int damage = std::max(0, attackPower - m.getDefense());
-        logger.log(name + " атакует " + m.getName() + " на " + std::to_string(damage) + " урона.");
-        try {
-            m.takeDamage(damage);
-        } catch (const std::runtime_error& e) {
-            std::cout << e.what() << std::endl;
+std::vector<HitBranch> monsterHitBranches(const CharacterBuild& hero, const Monster& monster, const CombatRules& rules) {
+    double flame = std::min(100, std::max(0, rules.flameChance)) / 100.0;
+    double poison = std::min(100, std::max(0, rules.poisonChance)) / 100.0;
+    std::vector<HitBranch> branches;
+    auto addPoison = [&](int received, double p) {
+        if (p == 0.0) return;
+        if (received > 0 && poison > 0.0) {
+            branches.push_back({received + rules.poisonBonus, p * poison});
+            if (poison < 1.0) branches.push_back({received, p * (1.0 - poison)});
+        } else {
+            branches.push_back({std::max(0, received), p});
         }
-    }
+    };
+    int received = monster.getAttack() - hero.defense;
+    addPoison(received + rules.flameBonus, flame);
+    addPoison(received, 1.0 - flame);
+    return branches;
+}
 
-    void takeDamage(int dmg) {
-        int realDmg = std::max(0, dmg - defense);
-        hp -= realDmg;
-        logger.log(name + " получает " + std::to_string(realDmg) + " урона.");
-        if (hp <= 0) {
-            throw std::runtime_error(name + " погиб!");
-        }
-    }
+DuelDistribution resolveDuel(const CharacterBuild& hero, const Monster& monster,
+                             const CombatRules& rules, int maxRounds = 10000) {
+    if (hero.hp <= 0) throw std::invalid_argument("HP персонажа должно быть положительным.");
 
-    void heal(int amount) {
-        hp += amount;
-        if (hp > 100) hp = 100;
-        logger.log(name + " лечится на " + std::to_string(amount) + " HP.");
+    DuelDistribution result;
+    result.hpLeftProbability.assign(hero.hp + 1, 0.0);
+    if (monster.getHP() <= 0) {
+        result.winProbability = 1.0;
+        result.roundProbability = {1.0};
+        result.hpLeftProbability[hero.hp] = 1.0;
+        result.expectedHpLeft = hero.hp;
+        result.expectedXp = 50.0;
+        return result;
     }
 
-    void gainExperience(int exp) {
-        experience += exp;
-        if (experience >= 100) {
-            level++;
-            experience = 0;
-            logger.log(name + " повысил уровень до " + std::to_string(level));
+    const std::vector<HitBranch> heroHits = heroHitBranches(hero, monster, rules);
+    const std::vector<HitBranch> monsterHits = monsterHitBranches(hero, monster, rules);
+    const int width = monster.getHP() + 1;
+    auto index = [width](int h, int m) { return static_cast<size_t>(h) * width + m; };
+
+    // Плотная сетка вероятностей и список занятых клеток текущего раунда
+    std::vector<double> current(static_cast<size_t>(hero.hp + 1) * width, 0.0);
+    std::vector<double> next(current.size(), 0.0);
+    std::vector<size_t> active{index(hero.hp, monster.getHP())};
+    std::vector<size_t> nextActive;
+    current[active[0]] = 1.0;
+    result.roundProbability.assign(1, 0.0);
+
+    for (int round = 1; round <= maxRounds && !active.empty(); ++round) {
+        double endedNow = 0.0;
+        nextActive.clear();
+        for (size_t cell : active) {
+            double p = current[cell];
+            current[cell] = 0.0;
+            int h = static_cast<int>(cell / width);
+            int m = static_cast<int>(cell % width);
+            for (const HitBranch& heroHit : heroHits) {
+                double ph = p * heroHit.probability;
+                int monsterLeft = m - heroHit.damage;
+                if (monsterLeft <= 0) {
+                    result.winProbability += ph;
+                    result.hpLeftProbability[h] += ph;
+                    endedNow += ph;
+                    continue;
+                }
+                for (const HitBranch& monsterHit : monsterHits) {
+                    double pm = ph * monsterHit.probability;
+                    int heroLeft = h - monsterHit.damage;
+                    if (heroLeft <= 0) {
+                        result.lossProbability += pm;
+                        result.hpLeftProbability[0] += pm;
+                        endedNow += pm;
+                        continue;
+                    }
+                    size_t to = index(heroLeft, monsterLeft);
+                    if (next[to] == 0.0) nextActive.push_back(to);
+                    next[to] += pm;
+                }
+            }
         }
+        result.roundProbability.push_back(endedNow);
+        std::swap(current, next);
+        std::swap(active, nextActive);
     }
 
-    void display() const {
-        std::cout << name << " (HP: " << hp << ", ATK: " << attackPower
-                  << ", DEF: " << defense << ", LVL: " << level << ", EXP: " << experience << ")\n";
-        inventory.display();
+    // Что не закончилось за maxRounds, simulateFight считает ничьей
+    for (size_t cell : active) {
+        double p = current[cell];
+        int h = static_cast<int>(cell / width);
+        result.unresolvedProbability += p;
+        result.hpLeftProbability[h] += p;
+        result.roundProbability.back() += p;
     }
 
-    void addItem(const std::string& item) {
-        inventory.addItem(item);
-        logger.log(name + " получает предмет: " + item);
-    }
+    for (size_t r = 0; r < result.roundProbability.size(); ++r)
+        result.expectedRounds += static_cast<double>(r) * result.roundProbability[r];
+    for (size_t h = 0; h < result.hpLeftProbability.size(); ++h)
+        result.expectedHpLeft += static_cast<double>(h) * result.hpLeftProbability[h];
+    result.expectedXp = 50.0 * result.winProbability;
+    return result;
+}
 
-    void save(const std::string& filename) {
-        std::ofstream out(filename);
-        if (!out) throw std::runtime_error("Ошибка сохранения!");
-        out << name << "\n" << hp << "\n" << attackPower << "\n" << defense << "\n"
-            << level << "\n" << experience << "\n";
-        const auto& items = inventory.getItems();
-        out << items.size() << "\n";
-        for (const auto& item : items) out << item << "\n";
-    }
+// Таблица баланса: каждый билд против каждого монстра
+std::vector<std::vector<DuelDistribution>> balanceMatrix(const std::vector<CharacterBuild>& builds,
+                                                         const std::vector<MonsterType>& monsters,
+                                                         const CombatRules& rules) {
+    std::vector<Monster> prototypes(monsters.begin(), monsters.end());
 
-    void load(const std::string& filename) {
-        std::ifstream in(filename);
-        if (!in) throw std::runtime_error("Ошибка загрузки!");
-        size_t invSize;
-        std::string item;
-        in >> name >> hp >> attackPower >> defense >> level >> experience >> invSize;
-        std::getline(in, item); // очистка строки
-        for (size_t i = 0; i < invSize; ++i) {
-            std::getline(in, item);
-            inventory.addItem(item);
-        }
+    std::vector<std::vector<DuelDistribution>> matrix(builds.size());
+    for (size_t b = 0; b < builds.size(); ++b) {
+        matrix[b].reserve(monsters.size());
+        for (const Monster& monster : prototypes)
+            matrix[b].push_back(resolveDuel(builds[b], monster, rules));
     }
-};
-
-// Реализация атаки монстра на персонажа
-void Monster::attack(Character& c) {
-    c.takeDamage(attackPower);
+    return matrix;
 }
 
 // ---------- Класс Game ----------
+// Команды игры; меню и сценарии сводятся к одним и тем же командам
+enum class Command { New, Load, Fight, Heal, Save, Quit, Unknown };
+constexpr size_t kCommandCount = 7;
+
+const char* commandName(Command c) {
+    static const char* const names[kCommandCount] = {"new", "load", "fight", "heal", "save", "quit", "unknown"};
+    return names[static_cast<size_t>(c)];
+}
+
+Command parseCommand(const std::string& word) {
+    for (size_t i = 0; i + 1 < kCommandCount; ++i) {
+        if (word == commandName(static_cast<Command>(i))) return static_cast<Command>(i);
+    }
+    return Command::Unknown;
+}
+
 class Game {
 private:
     std::unique_ptr<Character> player;
+    RollStream rolls;
+    std::istream& in;
+    std::ostream& out;
+    std::string savePath = "save.dat";
+    std::string legacySavePath = "save.txt";   // текстовое сохранение прежних версий
+    std::string logPath = "game_log.bin";   // основа имён сегментов журнала
+    LogSegments logSegments;
+    SaveService* saveService = nullptr;      // если задан, savePath - ключ в его журнале
 
 public:
+    explicit Game(uint64_t seed, uint64_t streamId = 0, std::istream& in = std::cin, std::ostream& out = std::cout)
+        : rolls(seed, streamId), in(in), out(out) {}
+
+    // Файлы сохранения и журнала (у параллельных сессий они свои)
+    void setFiles(const std::string& save, const std::string& log) {
+        savePath = save;
+        logPath = log;
+    }
+
+    // Сохранять через общий сервис групповой фиксации, а не в свой файл
+    void setSaveService(SaveService* service) {
+        saveService = service;
+    }
+
     void start() {
         std::string choice;
-        std::cout << "1. Новая игра\n2. Загрузить игру\nВыбор: ";
-        std::cin >> choice;
+        out << "1. Новая игра\n2. Загрузить игру\nВыбор: ";
+        in >> choice;
 
         if (choice == "2") {
-            try {
-                player = std::make_unique<Character>("Игрок");
-                player->load("save.txt");
-                std::cout << "Игра загружена!\n";
-            } catch (const std::exception& e) {
-                std::cout << "Ошибка: " << e.what() << "\nСоздание новой игры.\n";
-                newGame();
-            }
+            if (!loadGame()) newGame();
         } else {
             newGame();
         }
@@ -210,20 +2413,55 @@ public:
 
     void newGame() {
         std::string name;
-        std::cout << "Введите имя персонажа: ";
-        std::cin >> name;
-        player = std::make_unique<Character>(name);
+        out << "Введите имя персонажа: ";
+        in >> name;
+        newGame(name);
+    }
+
+    void newGame(const std::string& name) {
+        player = std::make_unique<Character>(name, logPath, logSegments);
         player->addItem("Меч");
         player->addItem("Зелье лечения");
     }
 
+    bool loadGame() {
+        try {
+            player = std::make_unique<Character>("Игрок", logPath, logSegments);
+            if (saveService) {
+                player->load(*saveService, savePath);
+                out << "Игра загружена!\n";
+                return true;
+            }
+            // Старое текстовое сохранение читается, если нового ещё нет;
+            // следующее сохранение запишет его уже в двоичном формате
+            bool migrate = !std::filesystem::exists(savePath) && std::filesystem::exists(legacySavePath);
+            player->load(migrate ? legacySavePath : savePath);
+            out << "Игра загружена!\n";
+            return true;
+        } catch (const std::exception& e) {
+            out << "Ошибка: " << e.what() << "\nСоздание новой игры.\n";
+            return false;
+        }
+    }
+
+    void saveGame() {
+        try {
+            if (saveService) player->save(*saveService, savePath).get();
+            else player->saveIncremental(savePath);
+            player->flushLog();   // сохранение фиксирует и журнал
+            out << "Игра сохранена!\n";
+        } catch (const std::exception& e) {
+            out << e.what() << std::endl;
+        }
+    }
+
     void gameLoop() {
         bool running = true;
         while (running) {
-            player->display();
-            std::cout << "1. Сразиться\n2. Лечение\n3. Сохранить\n4. Выйти\nВыбор: ";
+            player->display(out);
+            out << "1. Сразиться\n2. Лечение\n3. Сохранить\n4. Выйти\nВыбор: ";
             int choice;
-            std::cin >> choice;
+            in >> choice;
 
             switch (choice) {
                 case 1:
@@ -233,51 +2471,848 @@ public:
                     player->heal(20);
                     break;
                 case 3:
-                    try {
-                        player->save("save.txt");
-                        std::cout << "Игра сохранена!\n";
-                    } catch (const std::exception& e) {
-                        std::cout << e.what() << std::endl;
-                    }
+                    saveGame();
                     break;
                 case 4:
                     running = false;
                     break;
                 default:
-                    std::cout << "Неверный выбор.\n";
+                    out << "Неверный выбор.\n";
             }
         }
     }
 
+    // Выполняет одну команду сценария ("new Имя", "load", "fight", "heal",
+    // "save", "quit"); возвращает false, когда сессия закончена
+    bool execute(Command command, const std::string& argument) {
+        if (!player && command != Command::New && command != Command::Load && command != Command::Quit)
+            newGame("Игрок");
+
+        switch (command) {
+            case Command::New:
+                newGame(argument.empty() ? "Игрок" : argument);
+                break;
+            case Command::Load:
+                if (!loadGame()) newGame("Игрок");
+                break;
+            case Command::Fight:
+                fight();
+                break;
+            case Command::Heal:
+                player->heal(20);
+                break;
+            case Command::Save:
+                saveGame();
+                break;
+            case Command::Quit:
+                return false;
+            case Command::Unknown:
+                out << "Неверная команда.\n";
+                break;
+        }
+        return true;
+    }
+
     void fight() {
-        std::unique_ptr<Monster> monster;
-        int randType = rand() % 3;
-        if (randType == 0) monster = std::make_unique<Goblin>();
-        else if (randType == 1) monster = std::make_unique<Dragon>();
-        else monster = std::make_unique<Skeleton>();
+        // Строка трофея одна на всю игру: кириллица длиннее SSO, и временная
+        // строка на каждый бой была бы обращением к куче
+        static const std::string kTrophy = "Трофей монстра";
+        Monster monster(static_cast<MonsterType>(rolls.below(kMonsterTypeCount)));
 
-        std::cout << "Враг появился: ";
-        monster->display();
+        out << "Враг появился: ";
+        monster.display(out);
 
-        try {
-            while (!monster->isDead()) {
-                player->attackMonster(*monster);
-                if (!monster->isDead())
-                    monster->attack(*player);
+        while (!monster.isDead()) {
+            if (player->attackMonster(monster) == CombatOutcome::Died) {
+                out << monster.getName() << " умер!" << std::endl;
+                break;
             }
-            std::cout << "Монстр повержен!\n";
-            player->gainExperience(50);
-            player->addItem("Трофей монстра");
-        } catch (const std::exception& e) {
-            std::cout << "Бой завершен: " << e.what() << std::endl;
+            if (monster.attack(*player) == CombatOutcome::Died) {
+                out << "Бой завершен: " << player->getName() << " погиб!" << std::endl;
+                return;
+            }
+        }
+        out << "Монстр повержен!\n";
+        player->gainExperience(50);
+        player->addItem(kTrophy);
+    }
+};
+
+// ---------- Безголовый прогон сценариев ----------
+// Одна строка сценария - одна команда
+struct ScriptLine {
+    Command command;
+    std::string argument;
+};
+
+std::vector<ScriptLine> parseScript(std::istream& script) {
+    std::vector<ScriptLine> lines;
+    std::string line;
+    while (std::getline(script, line)) {
+        std::istringstream words(line);
+        std::string word, argument;
+        if (!(words >> word) || word[0] == '#') continue;
+        std::getline(words >> std::ws, argument);
+        lines.push_back({parseCommand(word), argument});
+    }
+    return lines;
+}
+
+// Прогоняет сценарий на игре; если timings не nullptr, добавляет туда
+// время каждой команды в наносекундах (по типам команд)
+void runScript(Game& game, const std::vector<ScriptLine>& script,
+               std::vector<std::vector<uint64_t>>* timings = nullptr) {
+    for (const ScriptLine& line : script) {
+        auto start = std::chrono::steady_clock::now();
+        bool running = game.execute(line.command, line.argument);
+        if (timings) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            (*timings)[static_cast<size_t>(line.command)].push_back(static_cast<uint64_t>(ns));
+        }
+        if (!running) break;
+    }
+}
+
+// Нагрузочный прогон: sessions сессий сценария на threads потоках без
+// консольного вывода; печатает команды в секунду и перцентили задержек.
+// С groupSave все сессии сохраняются через один SaveService
+void runLoadTest(const std::vector<ScriptLine>& script, size_t sessions, unsigned threads, bool groupSave = false) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "lab9_load_test";
+    std::filesystem::create_directories(dir);
+    std::optional<SaveService> service;
+    if (groupSave) service.emplace((dir / "saves.journal").string());
+
+    std::vector<std::vector<std::vector<uint64_t>>> perThread(threads, std::vector<std::vector<uint64_t>>(kCommandCount));
+    std::atomic<size_t> nextSession{0};
+
+    auto worker = [&](unsigned t) {
+        std::ostream silent(nullptr);   // консольный интерфейс выключен
+        std::istream noInput(nullptr);
+        std::string save = (dir / ("save_" + std::to_string(t) + ".dat")).string();
+        std::string log = (dir / ("log_" + std::to_string(t) + ".bin")).string();
+        for (size_t s = nextSession++; s < sessions; s = nextSession++) {
+            Game game(s, 0, noInput, silent);
+            game.setFiles(save, log);
+            if (service) game.setSaveService(&*service);
+            runScript(game, script, &perThread[t]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    SaveService::Stats saveStats;
+    if (service) saveStats = service->getStats();
+    service.reset();
+    std::filesystem::remove_all(dir);
+
+    size_t total = 0;
+    std::cout << "Сессий: " << sessions << ", потоков: " << threads << "\n";
+    if (groupSave && saveStats.batches > 0)
+        std::cout << "Групповая фиксация: " << saveStats.saves << " сохранений в " << saveStats.batches
+                  << " пачках\n";
+    std::cout << "команда   кол-во     p50 мкс   p90 мкс   p99 мкс   max мкс\n";
+    for (size_t c = 0; c < kCommandCount; ++c) {
+        std::vector<uint64_t> all;
+        for (const auto& timings : perThread) all.insert(all.end(), timings[c].begin(), timings[c].end());
+        if (all.empty()) continue;
+        std::sort(all.begin(), all.end());
+        total += all.size();
+        auto pct = [&all](double p) { return all[static_cast<size_t>(p * static_cast<double>(all.size() - 1))] / 1000.0; };
+        std::cout << commandName(static_cast<Command>(c)) << "\t  " << all.size() << "\t  " << pct(0.5) << "\t  "
+                  << pct(0.9) << "\t  " << pct(0.99) << "\t  " << all.back() / 1000.0 << "\n";
+    }
+    std::cout << "Команд в секунду: " << static_cast<double>(total) / elapsed << "\n";
+}
+
+
+// Безголовая оценка боёв: Lab9 --estimate
+void runEstimates() {
+    CharacterBuild hero;
+    EstimatorConfig config;
+
+    CombatRules plain;
+    CombatRules modifiers;
+    modifiers.critChance = 20;
+    modifiers.poisonChance = 30;
+
+    for (uint32_t t = 0; t < kMonsterTypeCount; ++t) {
+        MonsterType type = static_cast<MonsterType>(t);
+        std::string name(kMonsterArchetypes[t].name);
+        printEstimate(name + ", правила Lab9", estimateBattle(hero, type, plain, config));
+        printEstimate(name + ", крит и яд", estimateBattle(hero, type, modifiers, config));
+    }
+}
+
+// Прежний путь для сравнения: смерть сообщается исключением со свежей строкой
+void throwingTakeDamage(Monster& m, int dmg) {
+    if (m.takeDamage(dmg) == CombatOutcome::Died)
+        throw std::runtime_error(std::string(m.getName()) + " умер!");
+}
+
+// Сравнение смерти через исключение и через CombatOutcome: Lab9 --bench-combat
+void runCombatOutcomeBenchmark(size_t fights) {
+    std::vector<Monster> throwingSide(fights, Monster(MonsterType::Goblin));
+    std::vector<Monster> outcomeSide = throwingSide;
+    size_t throwingKills = 0;
+    size_t outcomeKills = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& m : throwingSide) {
+        try {
+            while (true) throwingTakeDamage(m, 8);
+        } catch (const std::runtime_error&) {
+            ++throwingKills;
+        }
+    }
+    auto throwingTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (auto& m : outcomeSide) {
+        while (m.takeDamage(8) == CombatOutcome::Alive) {}
+        ++outcomeKills;
+    }
+    auto outcomeTime = std::chrono::steady_clock::now() - start;
+
+    double throwingSec = std::chrono::duration<double>(throwingTime).count();
+    double outcomeSec = std::chrono::duration<double>(outcomeTime).count();
+    std::cout << "Боёв: " << fights << ", убийств: " << throwingKills << " / " << outcomeKills << "\n";
+    std::cout << "Исключения:    " << fights / throwingSec << " боёв/с\n";
+    std::cout << "CombatOutcome: " << fights / outcomeSec << " боёв/с\n";
+    std::cout << "Ускорение: x" << throwingSec / outcomeSec << "\n";
+}
+
+// Таблица баланса и сверка с Монте-Карло: Lab9 --balance
+void runBalanceMatrix() {
+    CombatRules rules;
+    rules.critChance = 20;
+    rules.poisonChance = 30;
+
+    std::vector<CharacterBuild> builds;
+    for (int attack = 8; attack <= 20; attack += 4) {
+        for (int defense = 3; defense <= 9; defense += 3) {
+            CharacterBuild b;
+            b.attackPower = attack;
+            b.defense = defense;
+            builds.push_back(b);
         }
     }
+    const std::vector<MonsterType> monsters = {MonsterType::Goblin, MonsterType::Dragon, MonsterType::Skeleton};
+
+    auto start = std::chrono::steady_clock::now();
+    auto matrix = balanceMatrix(builds, monsters, rules);
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "ATK/DEF   Гоблин   Дракон   Скелет\n";
+    for (size_t b = 0; b < builds.size(); ++b) {
+        std::cout << builds[b].attackPower << "/" << builds[b].defense << "\t";
+        for (const auto& duel : matrix[b]) std::cout << "  " << duel.winProbability;
+        std::cout << "\n";
+    }
+    std::cout << "Матчей: " << builds.size() * monsters.size() << ", "
+              << elapsed / static_cast<double>(builds.size() * monsters.size()) << " мкс на матч\n";
+
+    CharacterBuild hero;
+    DuelDistribution exact = resolveDuel(hero, Monster(MonsterType::Skeleton), rules);
+    BattleEstimate sampled = estimateBattle(hero, MonsterType::Skeleton, rules, EstimatorConfig{});
+    std::cout << "Скелет: точно раундов " << exact.expectedRounds << ", HP " << exact.expectedHpLeft
+              << "; Монте-Карло " << sampled.rounds.mean << ", HP " << sampled.hpLeft.mean << "\n";
+}
+
+// Прежняя иерархия монстров (виртуальные классы в куче) - только для сравнения
+namespace legacy {
+
+class VirtualMonster {
+protected:
+    std::string_view name;
+    int hp;
+    int attackPower;
+    int defense;
+public:
+    VirtualMonster(std::string_view n, int h, int a, int d) : name(n), hp(h), attackPower(a), defense(d) {}
+    virtual ~VirtualMonster() {}
+
+    virtual int attack(int heroDefense) const { return std::max(0, attackPower - heroDefense); }
+
+    CombatOutcome takeDamage(int dmg) {
+        hp -= dmg;
+        return hp <= 0 ? CombatOutcome::Died : CombatOutcome::Alive;
+    }
+    int getDefense() const { return defense; }
 };
 
+class Goblin : public VirtualMonster {
+public:
+    Goblin() : VirtualMonster("Гоблин", 30, 5, 2) {}
+};
+
+class Dragon : public VirtualMonster {
+public:
+    Dragon() : VirtualMonster("Дракон", 100, 20, 10) {}
+};
+
+class Skeleton : public VirtualMonster {
+public:
+    Skeleton() : VirtualMonster("Скелет", 40, 8, 4) {}
+};
+
+std::unique_ptr<VirtualMonster> makeMonster(MonsterType type) {
+    switch (type) {
+        case MonsterType::Goblin: return std::make_unique<Goblin>();
+        case MonsterType::Dragon: return std::make_unique<Dragon>();
+        default: return std::make_unique<Skeleton>();
+    }
+}
+
+} // namespace legacy
+
+// Бои по таблице архетипов против виртуальной иерархии: Lab9 --bench-dispatch
+void runDispatchBenchmark(size_t fights) {
+    const CharacterBuild hero;
+    std::vector<MonsterType> encounters(fights);
+    RollStream rolls(7, 0);
+    for (auto& type : encounters) type = static_cast<MonsterType>(rolls.below(kMonsterTypeCount));
+
+    // Исход боя не важен, считаем раунды, чтобы компилятор не выбросил цикл
+    uint64_t virtualRounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (MonsterType type : encounters) {
+        std::unique_ptr<legacy::VirtualMonster> monster = legacy::makeMonster(type);
+        int heroHp = hero.hp;
+        int damage = std::max(0, hero.attackPower - monster->getDefense());
+        for (int round = 0; round < 100; ++round) {
+            ++virtualRounds;
+            if (monster->takeDamage(damage) == CombatOutcome::Died) break;
+            heroHp -= monster->attack(hero.defense);
+            if (heroHp <= 0) break;
+        }
+    }
+    double virtualSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t tableRounds = 0;
+    start = std::chrono::steady_clock::now();
+    for (MonsterType type : encounters) {
+        Monster monster(type);
+        int heroHp = hero.hp;
+        int damage = std::max(0, hero.attackPower - monster.getDefense());
+        int received = std::max(0, monster.getAttack() - hero.defense);
+        for (int round = 0; round < 100; ++round) {
+            ++tableRounds;
+            if (monster.takeDamage(damage) == CombatOutcome::Died) break;
+            heroHp -= received;
+            if (heroHp <= 0) break;
+        }
+    }
+    double tableSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Боёв: " << fights << ", раундов: " << virtualRounds << " / " << tableRounds << "\n";
+    std::cout << "Виртуальные классы: " << fights / virtualSec << " боёв/с\n";
+    std::cout << "Таблица архетипов:  " << fights / tableSec << " боёв/с\n";
+    std::cout << "Ускорение: x" << virtualSec / tableSec << "\n";
+}
+
+// Цена одной записи журнала в игровом потоке: Lab9 --bench-log
+void runLoggerBenchmark(size_t entries) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "lab9_bench_log.txt";
+    const std::string entry = "Герой атакует Гоблин на 8 урона.";
+
+    struct Mode {
+        const char* name;
+        LogDurability durability;
+    };
+    const Mode modes[] = {
+        {"Sync (std::endl)", LogDurability::Sync},
+        {"BatchFlush", LogDurability::BatchFlush},
+        {"Buffered", LogDurability::Buffered},
+    };
+
+    for (const Mode& mode : modes) {
+        std::filesystem::remove(path);
+        Logger<std::string> logger(path.string(), mode.durability);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < entries; ++i) logger.log(entry);
+        double logNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        logger.flush();
+        double flushMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << mode.name << ": " << logNs / static_cast<double>(entries) << " нс на запись, flush "
+                  << flushMs << " мс, файл " << std::filesystem::file_size(path) << " байт\n";
+    }
+
+#ifndef _WIN32
+    // Сегменты через mmap: по 4 МБ, хранятся последние 4
+    {
+        LogSegments segments;
+        segments.segmentBytes = 4 << 20;
+        segments.keepCount = 4;
+        {
+            Logger<std::string> logger(path.string(), segments);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < entries; ++i) logger.log(entry);
+            double logNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            logger.flush();
+            double flushMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Сегменты mmap: " << logNs / static_cast<double>(entries) << " нс на запись, flush "
+                      << flushMs << " мс";
+        }
+        uintmax_t kept = 0;
+        auto files = LogSegmentStore::list(path);
+        for (const auto& segment : files) {
+            kept += std::filesystem::file_size(segment.second);
+            std::filesystem::remove(segment.second);
+        }
+        std::cout << ", осталось сегментов " << files.size() << " (" << kept << " байт)\n";
+    }
+#endif
+
+    // То же событие в двоичном журнале, включая прежнюю сборку строки
+    std::filesystem::remove(path);
+    {
+        const std::string hero = "Герой";
+        const Monster goblin(MonsterType::Goblin);
+        double textNs = 0;
+        {
+            Logger<std::string> logger(path.string());
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < entries; ++i)
+                logger.log(hero + " атакует " + std::string(goblin.getName()) + " на " + std::to_string(8) + " урона.");
+            textNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            logger.flush();
+        }
+        uintmax_t textBytes = std::filesystem::file_size(path);
+        std::filesystem::remove(path);
+
+        double binaryNs = 0;
+        {
+            EventLog events(path.string());
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < entries; ++i) events.record<LogEvent::Attack>(hero, goblin.getName(), 8);
+            binaryNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            events.flush();
+        }
+        uintmax_t binaryBytes = std::filesystem::file_size(path);
+
+        std::cout << "Строка + Logger: " << textNs / static_cast<double>(entries) << " нс, "
+                  << textBytes << " байт\n";
+        std::cout << "EventLog:        " << binaryNs / static_cast<double>(entries) << " нс, "
+                  << binaryBytes << " байт (в " << static_cast<double>(textBytes) / static_cast<double>(binaryBytes)
+                  << " раз меньше)\n";
+    }
+
+    // Уровни: та же запись включённой и отключённой категории
+    std::filesystem::remove(path);
+    {
+        const std::string hero = "Герой";
+        LogLevel combatLevel = logFilter.level(LogCategory::Combat);
+        Logger<std::string> logger(path.string());
+        for (bool enabled : {true, false}) {
+            logFilter.setLevel(LogCategory::Combat, enabled ? LogLevel::Trace : LogLevel::Info);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < entries; ++i)
+                logger.log<LogLevel::Debug>(LogCategory::Combat, hero, " атакует Гоблин на ", 8, " урона.");
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "log<Debug>, combat " << (enabled ? "включён:  " : "отключён: ")
+                      << ns / static_cast<double>(entries) << " нс\n";
+        }
+        logFilter.setLevel(LogCategory::Combat, combatLevel);
+        logger.flush();
+    }
+    std::filesystem::remove(path);
+}
+
+// Сохранение и загрузка n персонажей: текстовый формат против двоичного
+// (Lab9 --bench-save)
+void runSaveBenchmark(size_t count) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "lab9_bench_save";
+    std::filesystem::create_directories(dir);
+
+    SaveData save;
+    save.name = "Сэр Ланселот Озёрный";   // с пробелами - текстовый формат такое не прочтёт
+    for (int i = 0; i < 20; ++i) save.items.push_back("Трофей монстра " + std::to_string(i));
+    SaveData word = save;
+    word.name = "Ланселот";
+
+    std::vector<std::string> paths(count), textPaths(count);
+    for (size_t i = 0; i < count; ++i) {
+        paths[i] = (dir / ("save_" + std::to_string(i) + ".dat")).string();
+        textPaths[i] = (dir / ("save_" + std::to_string(i) + ".txt")).string();
+    }
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& path : textPaths) {
+        std::ofstream out(path);
+        writeTextSave(out, word);
+    }
+    double textSave = seconds(start);
+    start = std::chrono::steady_clock::now();
+    size_t items = 0;
+    for (const auto& path : textPaths) {
+        std::ifstream in(path);
+        items += readTextSave(in).items.size();
+    }
+    double textLoad = seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for (const auto& path : paths) writeSaveFile(path, save);
+    double binarySave = seconds(start);
+    start = std::chrono::steady_clock::now();
+    bool intact = true;
+    for (const auto& path : paths) intact &= readSaveFile(path).name == save.name;
+    double binaryLoad = seconds(start);
+
+    // Разбор без файловой системы: сколько стоит сам формат
+    std::ostringstream textImage;
+    writeTextSave(textImage, word);
+    std::string binaryImage = encodeSave(save);
+    const size_t parses = 200000;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < parses; ++i) {
+        std::istringstream in(textImage.str());
+        items += readTextSave(in).items.size();
+    }
+    double textParse = seconds(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < parses; ++i) items += decodeSave(binaryImage.data(), binaryImage.size()).items.size();
+    double binaryParse = seconds(start);
+    std::filesystem::remove_all(dir);
+
+    auto us = [](double total, size_t n) { return total * 1e6 / static_cast<double>(n); };
+    std::cout << "Файлов: " << count << ", предметов у персонажа: " << save.items.size()
+              << ", имя с пробелами прочитано: " << (intact ? "да" : "нет") << "\n";
+    std::cout << "Текст:    сохранение " << us(textSave, count) << " мкс, загрузка " << us(textLoad, count)
+              << " мкс, разбор " << us(textParse, parses) << " мкс\n";
+    std::cout << "Двоичный: сохранение " << us(binarySave, count) << " мкс, загрузка " << us(binaryLoad, count)
+              << " мкс, разбор " << us(binaryParse, parses) << " мкс\n";
+    std::cout << "Ускорение: сохранение x" << textSave / binarySave << ", загрузка x" << textLoad / binaryLoad
+              << ", разбор x" << textParse / binaryParse << " (" << items << ")\n";
+}
+
+// Автосохранение после каждого удара: полный снимок против дельт в журнале
+// при разном размере инвентаря (Lab9 --bench-autosave)
+void runAutosaveBenchmark(size_t saves) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "lab9_bench_autosave";
+    std::filesystem::create_directories(dir);
+    std::string path = (dir / "save.dat").string();
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::cout << "Сохранений: " << saves << ", новый снимок каждые " << Character::kCompactEvery << " дельт\n";
+    for (size_t itemCount : {10, 100, 1000, 10000}) {
+        Character hero("Ланселот", (dir / "log.bin").string());
+        for (size_t i = 0; i < itemCount; ++i) hero.addItem("Трофей монстра " + std::to_string(i));
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < saves; ++i) {
+            hero.takeDamage(6 + static_cast<int>(i % 2));
+            hero.heal(1);
+            hero.save(path);
+        }
+        double full = seconds(start);
+        uintmax_t snapshotBytes = std::filesystem::file_size(path);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < saves; ++i) {
+            hero.takeDamage(6 + static_cast<int>(i % 2));
+            hero.heal(1);
+            hero.saveIncremental(path);
+        }
+        double delta = seconds(start);
+        hero.flushLog();
+
+        Character loaded("Проверка", (dir / "check.bin").string());
+        loaded.load(path);
+        bool intact = loaded.snapshot().hp == hero.snapshot().hp &&
+                      loaded.snapshot().items.size() == hero.snapshot().items.size();
+
+        auto us = [&](double total) { return total * 1e6 / static_cast<double>(saves); };
+        std::cout << "Предметов " << itemCount << ": снимок " << snapshotBytes << " байт, " << us(full)
+                  << " мкс; дельта " << us(delta) << " мкс; x" << full / delta
+                  << ", загрузка совпала: " << (intact ? "да" : "нет") << "\n";
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// Много игроков сохраняются одновременно: файл на каждое сохранение против
+// групповой фиксации в общий журнал (Lab9 --bench-group-save)
+void runGroupSaveBenchmark(unsigned threads, size_t savesPerThread) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "lab9_bench_group_save";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    SaveData save;
+    save.name = "Ланселот";
+    for (int i = 0; i < 20; ++i) save.items.push_back("Трофей монстра " + std::to_string(i));
+    size_t total = threads * savesPerThread;
+
+    // Запускает body(поток, номер сохранения) на threads потоках, возвращает сохранений в секунду
+    auto run = [&](auto body) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                for (size_t i = 0; i < savesPerThread; ++i) body(t, i);
+            });
+        }
+        for (auto& th : pool) th.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(total) / elapsed;
+    };
+    auto playerPath = [&](unsigned t, size_t i) {
+        return (dir / ("save_" + std::to_string(t) + "_" + std::to_string(i % 16) + ".dat")).string();
+    };
+
+    double perFile = run([&](unsigned t, size_t i) { writeSaveFile(playerPath(t, i), save); });
+    std::cout << "Потоков: " << threads << ", сохранений: " << total << "\n";
+    std::cout << "Файл на сохранение:              " << perFile << " сохр/с\n";
+#ifndef _WIN32
+    // То же, но с fdatasync - столько же надёжности, сколько даёт журнал
+    double perFileDurable = run([&](unsigned t, size_t i) {
+        std::string image = encodeSave(save);
+        std::string path = playerPath(t, i);
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return;
+        if (::write(fd, image.data(), image.size()) == static_cast<ssize_t>(image.size())) fdatasync(fd);
+        ::close(fd);
+    });
+    std::cout << "Файл на сохранение + fdatasync:  " << perFileDurable << " сохр/с\n";
+#endif
+
+    for (size_t window : {size_t(1), size_t(16)}) {
+        std::filesystem::remove(dir / "saves.journal");
+        SaveService service((dir / "saves.journal").string());
+        // window сохранений в полёте на поток: 1 - игрок ждёт каждое, как Game::saveGame
+        std::vector<std::deque<std::future<void>>> inFlight(threads);
+        double grouped = run([&](unsigned t, size_t i) {
+            inFlight[t].push_back(service.submit("player_" + std::to_string(t) + "_" + std::to_string(i % 16), save));
+            if (inFlight[t].size() >= window || i + 1 == savesPerThread) {
+                while (!inFlight[t].empty()) {
+                    inFlight[t].front().get();
+                    inFlight[t].pop_front();
+                }
+            }
+        });
+        SaveService::Stats stats = service.getStats();
+        std::cout << "Общий журнал, " << window << " в полёте на поток: " << grouped << " сохр/с, пачка в среднем "
+                  << static_cast<double>(stats.saves) / static_cast<double>(stats.batches) << "\n";
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// Размер и скорость обычного и компактного сохранения на типичных
+// инвентарях (Lab9 --bench-compress)
+void runCompressBenchmark() {
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::cout << "предметов  обычное  компактное  сжатие  кодирование мкс  разбор мкс\n";
+    for (size_t trophies : {20, 200, 2000, 20000}) {
+        SaveData save;
+        save.name = "Ланселот";
+        save.items = {"Меч", "Зелье лечения"};
+        for (size_t i = 0; i < trophies; ++i) save.items.push_back(i % 10 == 9 ? "Зелье лечения" : "Трофей монстра");
+
+        std::string plain = encodeSave(save);
+        std::string compact = encodeSave(save, SaveEncoding::Compact);
+        const size_t rounds = std::max<size_t>(10, 200000 / trophies);
+        size_t checksum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) checksum += encodeSave(save).size();
+        double plainEncode = seconds(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) checksum += encodeSave(save, SaveEncoding::Compact).size();
+        double compactEncode = seconds(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) checksum += decodeSave(plain.data(), plain.size()).items.size();
+        double plainDecode = seconds(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) checksum += decodeSave(compact.data(), compact.size()).items.size();
+        double compactDecode = seconds(start);
+
+        bool same = decodeSave(compact.data(), compact.size()).items == save.items;
+        auto us = [rounds](double total) { return total * 1e6 / static_cast<double>(rounds); };
+        std::cout << save.items.size() << "\t    " << plain.size() << "\t     " << compact.size() << "\t x"
+                  << static_cast<double>(plain.size()) / static_cast<double>(compact.size()) << "\t  " << us(plainEncode)
+                  << " / " << us(compactEncode) << "\t   " << us(plainDecode) << " / " << us(compactDecode)
+                  << (same && checksum ? "\n" : "  ОШИБКА\n");
+    }
+}
+
+// Инвентарь долгоживущего персонажа: список копий против стопок
+// (Lab9 --bench-inventory)
+void runInventoryBenchmark() {
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::cout << "подборов   строк: список / стопки   добавление мкс   подсчёт нс   удаление нс\n";
+    for (size_t pickups : {1000, 10000, 100000}) {
+        std::vector<std::string> loot;
+        loot.reserve(pickups);
+        for (size_t i = 0; i < pickups; ++i)
+            loot.push_back(i % 10 == 9 ? "Редкий трофей " + std::to_string(i % 200) : "Трофей монстра");
+        const size_t queries = 2000;
+
+        Inventory<std::string> list;
+        StackedInventory<std::string> stacked;
+        double add[2], count[2], remove[2];
+        size_t found = 0;
+        auto fill = [&](auto& inventory, int k) {
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& item : loot) inventory.addItem(item);
+            add[k] = seconds(start);
+        };
+        auto measure = [&](auto& inventory, int k) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t q = 0; q < queries; ++q) found += inventory.count(loot[q * 7 % pickups]);
+            count[k] = seconds(start);
+            // Продаём редкие трофеи по одному виду
+            start = std::chrono::steady_clock::now();
+            for (size_t q = 0; q < 200; ++q) inventory.removeItem("Редкий трофей " + std::to_string(q));
+            remove[k] = seconds(start);
+            inventory.clearChanges();
+        };
+        fill(list, 0);
+        fill(stacked, 1);
+        size_t stored[2] = {list.getItems().size(), stacked.distinctCount()};   // копий строк в памяти
+        measure(list, 0);
+        measure(stacked, 1);
+
+        bool same = list.getItems().size() == stacked.size() && stacked.count("Трофей монстра") == list.count("Трофей монстра");
+        std::cout << pickups << "\t   " << stored[0] << " / " << stored[1] << "\t\t" << add[0] * 1e6 << " / "
+                  << add[1] * 1e6 << "\t " << count[0] * 1e9 / queries << " / " << count[1] * 1e9 / queries << "\t "
+                  << remove[0] * 1e9 / 200 << " / " << remove[1] * 1e9 / 200 << (same && found ? "\n" : "  ОШИБКА\n");
+    }
+}
+
 // ---------- main ----------
-int main() {
-    srand(static_cast<unsigned>(time(0)));
-    Game game;
+int main(int argc, char* argv[]) {
+    // Уровни журнала: LAB9_LOG=info или LAB9_LOG=combat=warn,inventory=off
+    if (const char* spec = std::getenv("LAB9_LOG"); spec && !logFilter.configure(spec)) {
+        std::cerr << "Неверная настройка LAB9_LOG: " << spec << "\n";
+        return 1;
+    }
+    // Формат новых сохранений: LAB9_SAVE=compact или LAB9_SAVE=plain
+    if (const char* mode = std::getenv("LAB9_SAVE")) {
+        if (std::string_view(mode) == "compact") {
+            saveEncoding = SaveEncoding::Compact;
+        } else if (std::string_view(mode) != "plain") {
+            std::cerr << "Неверная настройка LAB9_SAVE: " << mode << "\n";
+            return 1;
+        }
+    }
+    if (argc > 1 && std::string(argv[1]) == "--estimate") {
+        runEstimates();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--balance") {
+        runBalanceMatrix();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-dispatch") {
+        runDispatchBenchmark(1000000);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--script") {
+        std::ifstream script(argv[2]);
+        if (!script) {
+            std::cerr << "Не удалось открыть сценарий " << argv[2] << "\n";
+            return 1;
+        }
+        Game game(static_cast<uint64_t>(time(0)));
+        runScript(game, parseScript(script));
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--load-test") {
+        std::ifstream script(argv[2]);
+        if (!script) {
+            std::cerr << "Не удалось открыть сценарий " << argv[2] << "\n";
+            return 1;
+        }
+        size_t sessions = argc > 3 ? std::stoul(argv[3]) : 1000;
+        unsigned threads = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : 0;
+        bool groupSave = argc > 5 && std::string(argv[5]) == "--group-save";
+        runLoadTest(parseScript(script), sessions, threads, groupSave);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-log") {
+        runLoggerBenchmark(1000000);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--decode-log") {
+        // Путь - отдельный файл журнала или основа имён его сегментов
+        std::vector<std::filesystem::path> files;
+        if (std::filesystem::is_regular_file(argv[2])) {
+            files.push_back(argv[2]);
+        } else {
+#ifndef _WIN32
+            for (const auto& segment : LogSegmentStore::list(argv[2])) files.push_back(segment.second);
+#endif
+        }
+        if (files.empty()) {
+            std::cerr << "Не удалось открыть журнал " << argv[2] << "\n";
+            return 1;
+        }
+        try {
+            for (const auto& file : files) {
+                std::ifstream log(file, std::ios::binary);
+                decodeEventLog(log, std::cout, argc > 3 && std::string(argv[3]) == "--time");
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-save") {
+        runSaveBenchmark(argc > 2 ? std::stoul(argv[2]) : 20000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-autosave") {
+        runAutosaveBenchmark(argc > 2 ? std::stoul(argv[2]) : 2000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-group-save") {
+        unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 0;
+        runGroupSaveBenchmark(threads, argc > 3 ? std::stoul(argv[3]) : 500);
+        return 0;
+    }
+    if (argc > 3 && std::string(argv[1]) == "--migrate-save") {
+        // Переводит старое текстовое сохранение (или снимок с журналом) в один
+        // двоичный файл; с --compact - в компактный
+        bool compact = argc > 4 && std::string(argv[4]) == "--compact";
+        try {
+            writeSaveFile(argv[3], readSaveWithJournal(argv[2]).data,
+                          compact ? SaveEncoding::Compact : saveEncoding);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-inventory") {
+        runInventoryBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-compress") {
+        runCompressBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-combat") {
+        runCombatOutcomeBenchmark(200000);
+        return 0;
+    }
+
+    Game game(static_cast<uint64_t>(time(0)));
     game.start();
     return 0;
 }
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// Общий кодек сохранений: varint/zigzag для чисел и блочное LZ-сжатие с
+// кадрами. Им пользуются Lab9 (журнал событий, компактные сохранения),
+// Lab10 (сжатый файл пользователей) и lab7.1 (сжатый снимок).
+
+// Целые числа пишутся как varint: по 7 бит в байте, старший бит - «дальше
+// ещё байт». Знаковые сначала переводятся в zigzag (0, -1, 1, -2, ...).
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// Читает varint из [p, end); false - данные оборвались или число длиннее 64 бит
+inline bool readVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// LZ77 с жадным поиском по хеш-таблице. Блок - последовательности
+// «varint число литералов, литералы, varint расстояние назад, varint
+// (длина совпадения - 4)»; после последних литералов ссылки нет. Ссылки
+// не выходят за блок, так что каждый блок разжимается сам по себе.
+constexpr size_t kMinMatch = 4;
+
+inline void compressBlock(std::string_view raw, std::string& out) {
+    const char* base = raw.data();
+    size_t end = raw.size();
+
+    std::vector<int32_t> table(1 << 14, -1);
+    auto hash = [base](size_t at) {
+        uint32_t word;
+        std::memcpy(&word, base + at, 4);
+        return (word * 2654435761u) >> 18;
+    };
+    size_t literal = 0;
+    size_t at = 0;
+    while (at + kMinMatch <= end) {
+        uint32_t slot = hash(at);
+        int32_t candidate = table[slot];
+        table[slot] = static_cast<int32_t>(at);
+        if (candidate < 0 || std::memcmp(base + candidate, base + at, kMinMatch) != 0) {
+            ++at;
+            continue;
+        }
+        size_t length = kMinMatch;
+        while (at + length < end && base[candidate + length] == base[at + length]) ++length;
+        appendVarint(out, at - literal);
+        out.append(base + literal, at - literal);
+        appendVarint(out, at - static_cast<size_t>(candidate));
+        appendVarint(out, length - kMinMatch);
+        at += length;
+        literal = at;
+    }
+    if (literal < end) {
+        appendVarint(out, end - literal);
+        out.append(base + literal, end - literal);
+    }
+}
+
+// Разжимает блок ровно в rawSize байт по адресу dst; false - блок повреждён
+inline bool decompressBlockTo(const char* p, const char* end, char* dst, size_t rawSize) {
+    size_t pos = 0;
+    while (pos < rawSize) {
+        uint64_t literals = 0;
+        if (!readVarint(p, end, literals) || literals > rawSize - pos || literals > static_cast<uint64_t>(end - p))
+            return false;
+        std::memcpy(dst + pos, p, literals);
+        p += literals;
+        pos += literals;
+        if (pos == rawSize) break;
+
+        uint64_t distance = 0;
+        uint64_t extra = 0;
+        if (!readVarint(p, end, distance) || !readVarint(p, end, extra)) return false;
+        if (distance == 0 || distance > pos || rawSize - pos < kMinMatch || extra > rawSize - pos - kMinMatch)
+            return false;
+        size_t length = extra + kMinMatch;
+        const char* from = dst + pos - distance;
+        if (distance >= length) {
+            std::memcpy(dst + pos, from, length);
+        } else {
+            for (size_t i = 0; i < length; ++i) dst[pos + i] = from[i];   // совпадение перекрывает само себя
+        }
+        pos += length;
+    }
+    return p == end;
+}
+
+// Дописывает в out rawSize разжатых байт; false - блок повреждён
+inline bool decompressBlock(const char* p, const char* end, size_t rawSize, std::string& out) {
+    size_t start = out.size();
+    out.resize(start + rawSize);
+    return decompressBlockTo(p, end, out.data() + start, rawSize);
+}
+
+// Кадр контейнера: varint исходный размер, varint размер данных, данные.
+// Если сжатие не помогло, блок хранится как есть (размеры равны).
+inline void appendFrame(std::string& out, std::string_view raw) {
+    std::string packed;
+    compressBlock(raw, packed);
+    bool stored = packed.size() >= raw.size();
+    appendVarint(out, raw.size());
+    appendVarint(out, stored ? raw.size() : packed.size());
+    if (stored) out += raw;
+    else out += packed;
+}
+
+// Разжимает очередной кадр в конец out; false - кадр повреждён
+inline bool readFrame(const char*& p, const char* end, std::string& out) {
+    uint64_t rawSize = 0;
+    uint64_t packedSize = 0;
+    if (!readVarint(p, end, rawSize) || !readVarint(p, end, packedSize)) return false;
+    if (packedSize > rawSize || packedSize > static_cast<uint64_t>(end - p)) return false;
+    const char* data = p;
+    p += packedSize;
+    if (packedSize == rawSize) {
+        out.append(data, rawSize);
+        return true;
+    }
+    return decompressBlock(data, data + packedSize, rawSize, out);
+}
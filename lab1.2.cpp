@@ -1,5 +1,13 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+
+#include "output_sink.h"
 
 class Entity {
 protected:
@@ -10,9 +18,16 @@ public:
     // Конструктор базового класса
     Entity(const std::string& n, int h) : name(n), health(h) {}
 
+    // Вывод информации в буфер; наследники дописывают свои поля
+    virtual void render(OutputSink& out) const {
+        out << "Name: " << name << ", HP: " << health << '\n';
+    }
+
     // Метод для вывода информации
-    virtual void displayInfo() const {
-        std::cout << "Name: " << name << ", HP: " << health << std::endl;
+    void displayInfo() const {
+        OutputSink& out = consoleSink();
+        render(out);
+        out.flush();
     }
 
     virtual ~Entity() {}
@@ -27,10 +42,10 @@ public:
     Player(const std::string& n, int h, int exp)
         : Entity(n, h), experience(exp) {}
 
-    // Переопределение метода displayInfo
-    void displayInfo() const override {
-        Entity::displayInfo(); // Вызов метода базового класса
-        std::cout << "Experience: " << experience << std::endl;
+    // Переопределение метода render
+    void render(OutputSink& out) const override {
+        Entity::render(out); // Вызов метода базового класса
+        out << "Experience: " << experience << '\n';
     }
 };
 
@@ -43,10 +58,10 @@ public:
     Enemy(const std::string& n, int h, const std::string& t)
         : Entity(n, h), type(t) {}
 
-    // Переопределение метода displayInfo
-    void displayInfo() const override {
-        Entity::displayInfo(); // Вызов метода базового класса
-        std::cout << "Type: " << type << std::endl;
+    // Переопределение метода render
+    void render(OutputSink& out) const override {
+        Entity::render(out); // Вызов метода базового класса
+        out << "Type: " << type << '\n';
     }
 };
 
@@ -59,27 +74,150 @@ public:
     Boss(const std::string& n, int h, const std::string& t, const std::string& ability)
         : Enemy(n, h, t), specialAbility(ability) {}
 
-    // Переопределение метода displayInfo
+    // Переопределение метода render
+    void render(OutputSink& out) const override {
+        Enemy::render(out); // Выводим имя, здоровье и тип
+        out << "Special Ability: " << specialAbility << '\n';
+    }
+};
+
+// Прежняя иерархия: displayInfo пишет построчно в std::cout с std::endl.
+// Нужна только для сравнения в runRosterDump
+namespace legacy {
+
+class Entity {
+protected:
+    std::string name;
+    int health;
+
+public:
+    Entity(const std::string& n, int h) : name(n), health(h) {}
+
+    virtual void displayInfo() const {
+        std::cout << "Name: " << name << ", HP: " << health << std::endl;
+    }
+
+    virtual ~Entity() {}
+};
+
+class Player : public Entity {
+private:
+    int experience;
+
+public:
+    Player(const std::string& n, int h, int exp) : Entity(n, h), experience(exp) {}
+
+    void displayInfo() const override {
+        Entity::displayInfo();
+        std::cout << "Experience: " << experience << std::endl;
+    }
+};
+
+class Enemy : public Entity {
+private:
+    std::string type;
+
+public:
+    Enemy(const std::string& n, int h, const std::string& t) : Entity(n, h), type(t) {}
+
+    void displayInfo() const override {
+        Entity::displayInfo();
+        std::cout << "Type: " << type << std::endl;
+    }
+};
+
+class Boss : public Enemy {
+private:
+    std::string specialAbility;
+
+public:
+    Boss(const std::string& n, int h, const std::string& t, const std::string& ability)
+        : Enemy(n, h, t), specialAbility(ability) {}
+
     void displayInfo() const override {
-        Enemy::displayInfo(); // Выводим имя, здоровье и тип
+        Enemy::displayInfo();
         std::cout << "Special Ability: " << specialAbility << std::endl;
     }
 };
 
-int main() {
+} // namespace legacy
+
+// Одинаковый ростер из count сущностей для обеих иерархий
+template<typename Base, typename P, typename E, typename B>
+std::vector<std::unique_ptr<Base>> makeRoster(size_t count) {
+    std::vector<std::unique_ptr<Base>> roster;
+    roster.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        int hp = 50 + static_cast<int>(i % 150);
+        if (i % 3 == 0) roster.push_back(std::make_unique<P>("Hero", hp, static_cast<int>(i)));
+        else if (i % 3 == 1) roster.push_back(std::make_unique<E>("Goblin", hp, "Goblin"));
+        else roster.push_back(std::make_unique<B>("Dragon", hp, "Dragon", "Fire Breath"));
+    }
+    return roster;
+}
+
+// Выгрузка ростера в файл во временном каталоге: через OutputSink и прежним
+// displayInfo (std::cout перенаправлен в файл, std::endl на каждой строке).
+// Запуск: lab1.2 --bench
+void runRosterDump(size_t count) {
+    auto roster = makeRoster<Entity, Player, Enemy, Boss>(count);
+    auto legacyRoster = makeRoster<legacy::Entity, legacy::Player, legacy::Enemy, legacy::Boss>(count);
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::filesystem::path sinkPath = dir / "lab1_2_roster_dump.txt";
+    std::filesystem::path legacyPath = dir / "lab1_2_roster_dump_legacy.txt";
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::ofstream file(sinkPath, std::ios::binary);
+        OutputSink out(file, 1 << 20);
+        for (const auto& entity : roster) entity->render(out);
+    }
+    double sinkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    {
+        std::ofstream file(legacyPath, std::ios::binary);
+        std::streambuf* console = std::cout.rdbuf(file.rdbuf());
+        for (const auto& entity : legacyRoster) entity->displayInfo();
+        std::cout.rdbuf(console);
+    }
+    double legacyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Оба способа должны дать один и тот же текст
+    auto readAll = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+    bool same = readAll(sinkPath) == readAll(legacyPath);
+    std::filesystem::remove(sinkPath);
+    std::filesystem::remove(legacyPath);
+
+    std::cout << "Roster of " << count << " entities: OutputSink " << sinkMs
+              << " ms, displayInfo with std::endl " << legacyMs << " ms"
+              << (same ? ", same output" : ", OUTPUT DIFFERS") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runRosterDump(1000000);
+        return 0;
+    }
+
     // Создаем объекты
     Player hero("Hero", 100, 0);
     Enemy monster("Goblin", 50, "Goblin");
     Boss finalBoss("Dragon", 200, "Dragon", "Fire Breath");
 
-    // Выводим информацию
-    hero.displayInfo();
-    std::cout << std::endl;
+    // Выводим информацию одной пачкой
+    OutputSink& out = consoleSink();
+    hero.render(out);
+    out << '\n';
 
-    monster.displayInfo();
-    std::cout << std::endl;
+    monster.render(out);
+    out << '\n';
 
-    finalBoss.displayInfo();
+    finalBoss.render(out);
+    out.flush();
 
     return 0;
 }
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <string>
 
+#include "output_sink.h"
+
 // Класс Character
 class Character {
 private:
@@ -19,10 +21,13 @@ public:
     }
 
     // Перегрузка оператора <<
+    void render(OutputSink& out) const {
+        out << "Character: " << name << ", HP: " << health
+            << ", Attack: " << attack << ", Defense: " << defense;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const Character& character) {
-        os << "Character: " << character.name << ", HP: " << character.health
-           << ", Attack: " << character.attack << ", Defense: " << character.defense;
-        return os;
+        return renderTo(os, character);
     }
 };
 
@@ -51,9 +56,12 @@ public:
     }
 
     // Перегрузка оператора <<
+    void render(OutputSink& out) const {
+        out << "Weapon: " << name << ", Damage: " << damage;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const Weapon& weapon) {
-        os << "Weapon: " << weapon.name << ", Damage: " << weapon.damage;
-        return os;
+        return renderTo(os, weapon);
     }
 };
 
@@ -70,14 +78,16 @@ int main() {
         std::cout << "Hero1 and Hero3 are different!\n";
     }
 
-    std::cout << hero1 << std::endl;
+    consoleSink() << hero1 << '\n';
+    consoleSink().flush();
 
     // Оружие
     Weapon sword("Sword", 50);
     Weapon bow("Bow", 30);
 
     Weapon combined = sword + bow;
-    std::cout << "Combined weapon: " << combined << std::endl;
+    consoleSink() << "Combined weapon: " << combined << '\n';
+    consoleSink().flush();
 
     if (sword > bow) {
         std::cout << sword.getName() << " is stronger than " << bow.getName() << std::endl;
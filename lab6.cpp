@@ -5,6 +5,8 @@
 #include <deque>
 #include <stdexcept>
 
+#include "output_sink.h"
+
 // Класс Character
 class Character {
 private:
@@ -21,10 +23,13 @@ public:
         return name == other.name && health == other.health;
     }
 
+    void render(OutputSink& out) const {
+        out << "Character: " << name << ", HP: " << health
+            << ", Attack: " << attack << ", Defense: " << defense;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const Character& character) {
-        os << "Character: " << character.name << ", HP: " << character.health
-           << ", Attack: " << character.attack << ", Defense: " << character.defense;
-        return os;
+        return renderTo(os, character);
     }
 };
 
@@ -48,9 +53,12 @@ public:
         return damage > other.damage;
     }
 
+    void render(OutputSink& out) const {
+        out << "Weapon: " << name << ", Damage: " << damage;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const Weapon& weapon) {
-        os << "Weapon: " << weapon.name << ", Damage: " << weapon.damage;
-        return os;
+        return renderTo(os, weapon);
     }
 };
 
@@ -74,18 +82,31 @@ public:
         }
     }
 
-    void displayInventory() const {
-        std::cout << "Inventory (" << size << "/" << capacity << "):" << std::endl;
+    void render(OutputSink& out) const {
+        out << "Inventory (" << size << "/" << capacity << "):\n";
         for (int i = 0; i < size; ++i) {
-            std::cout << "- " << items[i] << std::endl;
+            out << "- " << items[i] << '\n';
         }
     }
+
+    void displayInventory() const {
+        OutputSink& out = consoleSink();
+        render(out);
+        out.flush();
+    }
 };
 
 // Базовый класс Entity
 class Entity {
 public:
-    virtual void displayInfo() const = 0;
+    virtual void render(OutputSink& out) const = 0;
+
+    void displayInfo() const {
+        OutputSink& out = consoleSink();
+        render(out);
+        out.flush();
+    }
+
     virtual int getHealth() const = 0;
     virtual ~Entity() = default;
 };
@@ -100,8 +121,8 @@ private:
 public:
     Player(const std::string& n, int h, int l) : name(n), health(h), level(l) {}
 
-    void displayInfo() const override {
-        std::cout << "Player: " << name << ", HP: " << health << ", Level: " << level << std::endl;
+    void render(OutputSink& out) const override {
+        out << "Player: " << name << ", HP: " << health << ", Level: " << level << '\n';
     }
 
     int getHealth() const override {
@@ -119,8 +140,8 @@ private:
 public:
     Enemy(const std::string& n, int h, const std::string& t) : name(n), health(h), type(t) {}
 
-    void displayInfo() const override {
-        std::cout << "Enemy: " << name << ", HP: " << health << ", Type: " << type << std::endl;
+    void render(OutputSink& out) const override {
+        out << "Enemy: " << name << ", HP: " << health << ", Type: " << type << '\n';
     }
 
     int getHealth() const override {
@@ -142,10 +163,13 @@ public:
         entities.push_back(std::move(entity));
     }
 
+    // Весь список уходит в консоль одной записью
     void displayAll() const {
+        OutputSink& out = consoleSink();
         for (const auto& entity : entities) {
-            entity->displayInfo();
+            entity->render(out);
         }
+        out.flush();
     }
 };
 
@@ -1,10 +1,26 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <string>
 #include <vector>
 #include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <cstdint>
+#include <random>
+#include <atomic>
+#include <barrier>
+#include <algorithm>
+#include <coroutine>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <utility>
+#include <charconv>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 // Класс для монстра
 class Monster {
@@ -62,62 +78,920 @@ public:
     }
 };
 
-// Глобальные объекты для персонажа и монстра
-Character hero("Hero", 100, 20, 10);
-Monster monster("Goblin", 80, 15, 5);
+// ---------- Пакетный расчёт урона ----------
+// Правило урона везде одно: attack - defense, не меньше нуля; если урон
+// положительный, здоровье уменьшается и обрезается снизу нулём.
+inline int32_t hitDamage(int32_t attack, int32_t defense) {
+    int32_t damage = attack - defense;
+    return damage > 0 ? damage : 0;
+}
+
+// Волна ударов в формате SoA: i-й удар наносится атакующим attack[i]
+// по цели с defense[i] и health[i]. Каждая цель встречается в волне
+// не более одного раза, поэтому удары волны независимы.
+struct HitWave {
+    std::vector<int16_t> attack;
+    std::vector<int16_t> defense;
+    std::vector<int32_t> health;
+    std::vector<int32_t> damage;   // результат: нанесённый урон
+
+    void resize(size_t n) {
+        attack.resize(n);
+        defense.resize(n);
+        health.resize(n);
+        damage.resize(n);
+    }
+
+    size_t size() const { return health.size(); }
+};
+
+// Скалярная версия - эталон, с которым сверяются SIMD-ветки
+void resolveHitsScalar(const int16_t* attack, const int16_t* defense,
+                       int32_t* health, int32_t* damage, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        int32_t d = hitDamage(attack[i], defense[i]);
+        damage[i] = d;
+        if (d > 0) {
+            health[i] -= d;
+            if (health[i] < 0) health[i] = 0;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+const char* const kHitKernel = "AVX2";
+
+void resolveHitsVector(const int16_t* attack, const int16_t* defense,
+                       int32_t* health, int32_t* damage, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(attack + i)));
+        __m256i d = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(defense + i)));
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(health + i));
+        __m256i dmg = _mm256_max_epi32(_mm256_sub_epi32(a, d), zero);
+        __m256i hit = _mm256_cmpgt_epi32(dmg, zero);
+        __m256i left = _mm256_max_epi32(_mm256_sub_epi32(h, dmg), zero);
+        // Без попадания здоровье не трогаем - так же, как скалярная ветка
+        h = _mm256_blendv_epi8(h, left, hit);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(health + i), h);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(damage + i), dmg);
+    }
+    resolveHitsScalar(attack, defense, health, damage, i, count);
+}
+#elif defined(__SSE2__)
+const char* const kHitKernel = "SSE2";
+
+// В SSE2 нет знакового max и blend для int32, поэтому собираем их из масок
+inline __m128i clampToZero(__m128i v) {
+    return _mm_and_si128(v, _mm_cmpgt_epi32(v, _mm_setzero_si128()));
+}
 
-// Мьютекс для синхронизации доступа к общим данным
-std::mutex battleMutex;
+inline __m128i widen16(const int16_t* p) {
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+void resolveHitsVector(const int16_t* attack, const int16_t* defense,
+                       int32_t* health, int32_t* damage, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(health + i));
+        __m128i dmg = clampToZero(_mm_sub_epi32(widen16(attack + i), widen16(defense + i)));
+        __m128i hit = _mm_cmpgt_epi32(dmg, zero);
+        __m128i left = clampToZero(_mm_sub_epi32(h, dmg));
+        h = _mm_or_si128(_mm_and_si128(hit, left), _mm_andnot_si128(hit, h));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(health + i), h);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(damage + i), dmg);
+    }
+    resolveHitsScalar(attack, defense, health, damage, i, count);
+}
+#else
+const char* const kHitKernel = "scalar";
 
-// Функция, которая имитирует бой между персонажем и монстром
-void battle() {
-    while (hero.isAlive() && monster.isAlive()) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+void resolveHitsVector(const int16_t* attack, const int16_t* defense,
+                       int32_t* health, int32_t* damage, size_t count) {
+    resolveHitsScalar(attack, defense, health, damage, 0, count);
+}
+#endif
+
+// Разрешает всю волну ударов за один вызов (ветка выбирается при компиляции:
+// -mavx2 даёт AVX2, обычная сборка под x86-64 - SSE2)
+void resolveHitWave(HitWave& wave) {
+    resolveHitsVector(wave.attack.data(), wave.defense.data(),
+                      wave.health.data(), wave.damage.data(), wave.size());
+}
+
+// Сверка пакетного ядра со скалярным путём на случайной массовой битве
+// (lab7.2 --bench-hits)
+void verifyHitKernel(size_t hits) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> stat(-50, 400);
+    std::uniform_int_distribution<int> hp(-20, 1000);
+
+    HitWave wave;
+    wave.resize(hits);
+    for (size_t i = 0; i < hits; ++i) {
+        wave.attack[i] = static_cast<int16_t>(stat(gen));
+        wave.defense[i] = static_cast<int16_t>(stat(gen));
+        wave.health[i] = hp(gen);
+    }
+    HitWave reference = wave;
 
-        // Бой (персонаж атакует монстра, затем монстр атакует персонажа)
+    auto start = std::chrono::steady_clock::now();
+    resolveHitsScalar(reference.attack.data(), reference.defense.data(),
+                      reference.health.data(), reference.damage.data(), 0, hits);
+    auto scalarTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    resolveHitWave(wave);
+    auto batchTime = std::chrono::steady_clock::now() - start;
+
+    bool same = wave.health == reference.health && wave.damage == reference.damage;
+    std::cout << "Hit kernel (" << kHitKernel << "): " << hits << " hits, scalar "
+              << std::chrono::duration<double, std::milli>(scalarTime).count() << " ms, batch "
+              << std::chrono::duration<double, std::milli>(batchTime).count() << " ms, "
+              << (same ? "results match" : "RESULTS DIFFER") << std::endl;
+}
+
+// ---------- Журнал боёв без блокировок ----------
+// Потоки боёв кладут компактные записи в кольцевой буфер, а отдельный
+// поток-потребитель форматирует их и пишет в поток вывода. Боевые потоки
+// никогда не ждут ввода-вывода: если буфер полон, запись отбрасывается
+// и учитывается в счётчике потерь.
+enum class EventKind : uint8_t { Attack, Status, Victory };
+
+struct CombatEvent {
+    EventKind kind;
+    uint32_t actor;    // id бойца из реестра журнала
+    uint32_t target;   // для Attack - id цели
+    int32_t damage;    // для Attack - нанесённый урон
+    int32_t health;    // здоровье цели (Attack) или самого бойца (Status)
+};
+
+// Постоянные данные бойца, нужные только при форматировании
+struct FighterInfo {
+    std::string role;
+    std::string name;
+    int attack;
+    int defense;
+};
+
+class CombatLog {
+private:
+    // Ячейка кольца: номер последовательности говорит, чья сейчас очередь
+    struct Cell {
+        std::atomic<size_t> sequence;
+        CombatEvent event;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;   // трогает только потребитель
+    std::atomic<uint64_t> dropped{0};
+    uint64_t written = 0;
+
+    std::mutex registryMutex;            // только для регистрации и форматирования имён
+    std::vector<FighterInfo> fighters;
+    // Бойцы закончившихся боёв. Их события могут ещё лежать в кольце, поэтому
+    // номер освобождается, только когда потребитель прочёл всё до after
+    struct Retired {
+        uint32_t id;
+        size_t after;
+    };
+    std::vector<Retired> retired;
+    std::vector<uint32_t> freeIds;       // номера, которые можно выдать снова
+
+    std::ostream& out;
+    std::atomic<bool> stopping{false};
+    std::thread consumer;
+
+    bool pop(CombatEvent& event) {
+        Cell& cell = cells[dequeuePos & mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != dequeuePos + 1) return false;
+        event = cell.event;
+        cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        ++dequeuePos;
+        return true;
+    }
+
+    // Число дописывается прямо в конец буфера, без временных строк
+    static void appendNumber(std::string& buffer, int value) {
+        size_t at = buffer.size();
+        buffer.resize(at + 11);
+        auto result = std::to_chars(buffer.data() + at, buffer.data() + buffer.size(), value);
+        buffer.resize(static_cast<size_t>(result.ptr - buffer.data()));
+    }
+
+    // Отдаёт номера бойцов, чьих событий в кольце больше нет
+    void reclaimRetired() {
+        size_t kept = 0;
+        for (const Retired& r : retired) {
+            if (r.after <= dequeuePos) freeIds.push_back(r.id);
+            else retired[kept++] = r;
+        }
+        retired.resize(kept);
+    }
+
+    void format(std::string& buffer, const CombatEvent& e) {
+        const FighterInfo& actor = fighters[e.actor];
+        switch (e.kind) {
+            case EventKind::Attack:
+                buffer += actor.name;
+                buffer += " attacks ";
+                buffer += fighters[e.target].name;
+                if (e.damage > 0) {
+                    buffer += " for ";
+                    appendNumber(buffer, e.damage);
+                    buffer += " damage!\n";
+                } else {
+                    buffer += " but it's ineffective!\n";
+                }
+                break;
+            case EventKind::Status:
+                buffer += actor.role;
+                buffer += ": ";
+                buffer += actor.name;
+                buffer += ", Health: ";
+                appendNumber(buffer, e.health);
+                buffer += ", Attack: ";
+                appendNumber(buffer, actor.attack);
+                buffer += ", Defense: ";
+                appendNumber(buffer, actor.defense);
+                buffer += "\n";
+                break;
+            case EventKind::Victory:
+                buffer += actor.name;
+                buffer += " wins the battle!\n";
+                break;
+        }
+    }
+
+    // Забирает всё, что накопилось, и пишет одной операцией. Реестр
+    // заблокирован только на время форматирования: запись в поток идёт
+    // без него, чтобы registerFighter не ждал ввода-вывода потребителя
+    bool drain(std::string& buffer) {
+        buffer.clear();
+        CombatEvent event;
         {
-            std::lock_guard<std::mutex> lock(battleMutex);
-            // Персонаж атакует монстра
-            int damageToMonster = hero.attack - monster.defense;
-            if (damageToMonster > 0) {
-                monster.takeDamage(damageToMonster);
-                std::cout << hero.name << " attacks " << monster.name << " for " << damageToMonster << " damage!\n";
-            } else {
-                std::cout << hero.name << " attacks " << monster.name << " but it's ineffective!\n";
+            std::lock_guard<std::mutex> lock(registryMutex);
+            while (buffer.size() < (1 << 16) && pop(event)) {
+                format(buffer, event);
+                ++written;
             }
+            if (!retired.empty()) reclaimRetired();
+        }
+        if (buffer.empty()) return false;
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.flush();
+        return true;
+    }
+
+    void consume() {
+        std::string buffer;
+        buffer.reserve(1 << 17);
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (!drain(buffer)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (drain(buffer)) {}
+    }
+
+public:
+    // capacity округляется вверх до степени двойки
+    explicit CombatLog(std::ostream& out, size_t capacity = 1 << 16) : out(out) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells = std::make_unique<Cell[]>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+        consumer = std::thread(&CombatLog::consume, this);
+    }
+
+    ~CombatLog() {
+        stop();
+    }
+
+    CombatLog(const CombatLog&) = delete;
+    CombatLog& operator=(const CombatLog&) = delete;
 
-            // Монстр атакует персонажа
-            int damageToHero = monster.attack - hero.defense;
-            if (damageToHero > 0) {
-                hero.takeDamage(damageToHero);
-                std::cout << monster.name << " attacks " << hero.name << " for " << damageToHero << " damage!\n";
+    // Реестр растёт до числа одновременно идущих боёв, а не всех боёв за
+    // время жизни журнала: номера закончившихся боёв выдаются снова
+    uint32_t registerFighter(const std::string& role, const std::string& name, int attack, int defense) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (freeIds.empty()) {
+            fighters.push_back({role, name, attack, defense});
+            return static_cast<uint32_t>(fighters.size() - 1);
+        }
+        uint32_t id = freeIds.back();
+        freeIds.pop_back();
+        FighterInfo& info = fighters[id];
+        info.role = role;
+        info.name = name;
+        info.attack = attack;
+        info.defense = defense;
+        return id;
+    }
+
+    // Бой закончен, новых событий с этим бойцом не будет. Вызывать после
+    // последнего push с его номером
+    void releaseFighter(uint32_t id) {
+        size_t after = enqueuePos.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        retired.push_back({id, after});
+    }
+
+    // Неблокирующая запись; false - буфер полон, событие отброшено
+    bool push(const CombatEvent& event) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.event = event;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
             } else {
-                std::cout << monster.name << " attacks " << hero.name << " but it's ineffective!\n";
+                pos = enqueuePos.load(std::memory_order_relaxed);
             }
         }
-        
-        // Вывод текущих состояний
+    }
+
+    // Дописывает всё накопленное и останавливает поток-потребитель
+    void stop() {
+        if (!consumer.joinable()) return;
+        stopping.store(true, std::memory_order_release);
+        consumer.join();
+    }
+
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t writtenCount() const { return written; }   // точно только после stop()
+};
+
+class Battle;
+
+// Волны ударов одной пачки боёв; у каждого рабочего потока свои, чтобы
+// память под волны выделялась один раз, а не на каждом тике
+struct RoundWaves {
+    std::vector<Battle*> active;   // i-й бой наносит i-е удары обеих волн
+    HitWave heroHits;              // удары героев по монстрам
+    HitWave monsterHits;           // ответные удары монстров
+};
+
+void stepBattles(Battle* const* battles, size_t count, RoundWaves& waves);
+
+// Бой между персонажем и монстром. Один вызов step() - один раунд;
+// когда и с какой скоростью вызывать раунды, решает планировщик.
+class Battle {
+public:
+    Character hero;
+    Monster monster;
+
+private:
+    CombatLog* log;   // nullptr - бой идёт молча
+    uint32_t heroId = 0;
+    uint32_t monsterId = 0;
+
+    static bool fitsInt16(int value) {
+        return value >= INT16_MIN && value <= INT16_MAX;
+    }
+
+public:
+    Battle(const Character& h, const Monster& m, CombatLog* log = nullptr)
+        : hero(h), monster(m), log(log) {
+        if (log) {
+            heroId = log->registerFighter("Character", hero.name, hero.attack, hero.defense);
+            monsterId = log->registerFighter("Monster", monster.name, monster.attack, monster.defense);
+        }
+    }
+
+    bool isFinished() const {
+        return !hero.isAlive() || !monster.isAlive();
+    }
+
+    // Персонаж атакует монстра; возвращает нанесённый урон
+    int heroStrike() {
+        int damage = hitDamage(hero.attack, monster.defense);
+        if (damage > 0) monster.takeDamage(damage);
+        return damage;
+    }
+
+    // Монстр атакует персонажа
+    int monsterStrike() {
+        int damage = hitDamage(monster.attack, hero.defense);
+        if (damage > 0) hero.takeDamage(damage);
+        return damage;
+    }
+
+    // Атаку и защиту волна хранит в int16; бои с большими значениями
+    // считаются по одному через heroStrike/monsterStrike
+    bool fitsHitWave() const {
+        return fitsInt16(hero.attack) && fitsInt16(hero.defense) &&
+               fitsInt16(monster.attack) && fitsInt16(monster.defense);
+    }
+
+    void step();
+
+    // Записывает итоги раунда в журнал
+    void report(int damageToMonster, int damageToHero) {
+        if (!log) return;
+        log->push({EventKind::Attack, heroId, monsterId, damageToMonster, monster.health});
+        log->push({EventKind::Attack, monsterId, heroId, damageToHero, hero.health});
+        // Текущие состояния
+        log->push({EventKind::Status, heroId, 0, 0, hero.health});
+        log->push({EventKind::Status, monsterId, 0, 0, monster.health});
+        // Завершение боя
+        if (isFinished()) {
+            log->push({EventKind::Victory, hero.isAlive() ? heroId : monsterId, 0, 0, 0});
+            log->releaseFighter(heroId);
+            log->releaseFighter(monsterId);
+        }
+    }
+};
+
+// Один раунд для пачки боёв. Бой (персонаж атакует монстра, затем монстр
+// атакует персонажа) идёт так же, как раньше, но удары всех боёв пачки
+// собираются в две волны и разрешаются пакетным ядром: сначала все удары
+// героев, потом все ответы монстров. Каждый монстр и каждый герой в своей
+// волне встречается один раз, поэтому удары волны независимы.
+void stepBattles(Battle* const* battles, size_t count, RoundWaves& waves) {
+    waves.active.clear();
+    for (size_t i = 0; i < count; ++i) {
+        Battle* battle = battles[i];
+        if (battle->isFinished()) continue;
+        if (battle->fitsHitWave()) {
+            waves.active.push_back(battle);
+        } else {
+            int damageToMonster = battle->heroStrike();
+            int damageToHero = battle->monsterStrike();
+            battle->report(damageToMonster, damageToHero);
+        }
+    }
+
+    size_t n = waves.active.size();
+    if (n == 0) return;
+    HitWave& heroHits = waves.heroHits;
+    HitWave& monsterHits = waves.monsterHits;
+    heroHits.resize(n);
+    monsterHits.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Battle& b = *waves.active[i];
+        heroHits.attack[i] = static_cast<int16_t>(b.hero.attack);
+        heroHits.defense[i] = static_cast<int16_t>(b.monster.defense);
+        heroHits.health[i] = b.monster.health;
+        monsterHits.attack[i] = static_cast<int16_t>(b.monster.attack);
+        monsterHits.defense[i] = static_cast<int16_t>(b.hero.defense);
+        monsterHits.health[i] = b.hero.health;
+    }
+    resolveHitWave(heroHits);
+    resolveHitWave(monsterHits);
+    for (size_t i = 0; i < n; ++i) {
+        Battle& b = *waves.active[i];
+        b.monster.health = heroHits.health[i];
+        b.hero.health = monsterHits.health[i];
+        b.report(heroHits.damage[i], monsterHits.damage[i]);
+    }
+}
+
+void Battle::step() {
+    thread_local RoundWaves waves;
+    Battle* self = this;
+    stepBattles(&self, 1, waves);
+}
+
+// Режим часов планировщика
+enum class ClockMode {
+    RealTime,   // тики идут с шагом tickPeriod по настенным часам
+    TimeWarp    // тики идут так быстро, как позволяет процессор
+};
+
+// Планировщик с фиксированным шагом: все бои продвигаются на один раунд
+// за тик, раунды одного тика делят между собой несколько рабочих потоков.
+// Тысячи боёв живут на нескольких потоках вместо потока на каждый бой.
+class TickScheduler {
+private:
+    ClockMode mode;
+    std::chrono::nanoseconds tickPeriod;
+    unsigned workerCount;
+    std::vector<Battle*> battles;
+    uint64_t ticks = 0;
+
+public:
+    TickScheduler(ClockMode mode, std::chrono::nanoseconds tickPeriod, unsigned workers = 0)
+        : mode(mode), tickPeriod(tickPeriod),
+          workerCount(workers ? workers : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    void add(Battle& battle) {
+        battles.push_back(&battle);
+    }
+
+    // Игровое время, прошедшее с начала run()
+    std::chrono::nanoseconds simulatedTime() const {
+        return tickPeriod * static_cast<int64_t>(ticks);
+    }
+
+    uint64_t tickCount() const { return ticks; }
+
+    // Крутит тики, пока не закончатся все бои; возвращает число тиков
+    uint64_t run() {
+        const size_t chunk = 64;
+        std::atomic<size_t> nextBattle{0};
+        bool done = battles.empty();
+        auto start = std::chrono::steady_clock::now();
+
+        // Завершение тика выполняет один поток, когда все остальные дошли до барьера
+        auto finishTick = [&]() noexcept {
+            ++ticks;
+            nextBattle = 0;
+            done = std::all_of(battles.begin(), battles.end(), [](const Battle* b) { return b->isFinished(); });
+            if (!done && mode == ClockMode::RealTime) {
+                std::this_thread::sleep_until(start + tickPeriod * static_cast<int64_t>(ticks + 1));
+            }
+        };
+        std::barrier tickBarrier(static_cast<std::ptrdiff_t>(workerCount), finishTick);
+
+        auto worker = [&]() {
+            RoundWaves waves;
+            while (!done) {
+                for (size_t first = nextBattle.fetch_add(chunk); first < battles.size(); first = nextBattle.fetch_add(chunk)) {
+                    size_t last = std::min(battles.size(), first + chunk);
+                    stepBattles(battles.data() + first, last - first, waves);
+                }
+                tickBarrier.arrive_and_wait();
+            }
+        };
+
+        if (!done && mode == ClockMode::RealTime) std::this_thread::sleep_until(start + tickPeriod);
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < workerCount; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool) th.join();
+        return ticks;
+    }
+};
+
+// Час боёв в ускоренном режиме: бойцы снимают друг с друга по 1 HP за раунд
+// (lab7.2 --bench-timewarp)
+void runTimeWarpBattles(size_t count) {
+    // Журнал нарочно маленький: потребитель не успевает, и лишнее отбрасывается
+    std::ostream discard(nullptr);
+    CombatLog log(discard, 1 << 12);
+    std::vector<Battle> battles;
+    battles.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        int hp = 3000 + static_cast<int>(i % 601);
+        battles.emplace_back(Character("Hero", 3600, 11, 10), Monster("Goblin", hp, 11, 10), &log);
+    }
+
+    TickScheduler scheduler(ClockMode::TimeWarp, std::chrono::seconds(1));
+    for (auto& b : battles) scheduler.add(b);
+
+    auto start = std::chrono::steady_clock::now();
+    scheduler.run();
+    auto wall = std::chrono::steady_clock::now() - start;
+    log.stop();
+
+    size_t heroWins = std::count_if(battles.begin(), battles.end(), [](const Battle& b) { return b.hero.isAlive(); });
+    std::cout << "Time warp: " << count << " battles, "
+              << std::chrono::duration_cast<std::chrono::minutes>(scheduler.simulatedTime()).count()
+              << " simulated minutes in "
+              << std::chrono::duration<double, std::milli>(wall).count() << " ms, hero wins: " << heroWins << std::endl;
+    std::cout << "Combat log: " << log.writtenCount() << " events formatted, "
+              << log.droppedCount() << " dropped" << std::endl;
+}
+
+// ---------- Бои-корутины ----------
+// Каждый боец - корутина, которая засыпает на "следующем тике", "ходе
+// противника" или "задержке". Спящий бой занимает только кадры корутин,
+// а исполняет их небольшой общий пул потоков.
+class CoroutineExecutor;
+
+// Задача-корутина; кадр уничтожается вместе с объектом задачи
+class BattleTask {
+public:
+    struct promise_type {
+        // Сколько байт занимают кадры всех созданных корутин
+        static inline std::atomic<size_t> frameBytes{0};
+
+        static void* operator new(size_t size) {
+            frameBytes.fetch_add(size, std::memory_order_relaxed);
+            return ::operator new(size);
+        }
+        static void operator delete(void* p, size_t size) {
+            frameBytes.fetch_sub(size, std::memory_order_relaxed);
+            ::operator delete(p);
+        }
+
+        BattleTask get_return_object() {
+            return BattleTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    explicit BattleTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+    BattleTask(BattleTask&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    BattleTask(const BattleTask&) = delete;
+    BattleTask& operator=(const BattleTask&) = delete;
+    ~BattleTask() {
+        if (handle) handle.destroy();
+    }
+
+    std::coroutine_handle<> get() const { return handle; }
+    bool done() const { return handle.done(); }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Исполнитель: очередь готовых корутин, таймеры по номерам тиков и пул
+// потоков. Когда готовых корутин нет и все потоки простаивают, часы
+// переводятся на ближайший таймер - сразу (TimeWarp) или по настенным
+// часам (RealTime).
+class CoroutineExecutor {
+private:
+    ClockMode mode;
+    std::chrono::nanoseconds tickPeriod;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::coroutine_handle<>> ready;
+    std::map<uint64_t, std::vector<std::coroutine_handle<>>> timers;
+    uint64_t tick = 0;
+    unsigned busy = 0;
+    bool finished = false;
+    uint64_t resumes = 0;
+    std::chrono::steady_clock::time_point start;
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!finished) {
+            if (!ready.empty()) {
+                std::coroutine_handle<> h = ready.front();
+                ready.pop_front();
+                ++busy;
+                ++resumes;
+                lock.unlock();
+                h.resume();
+                lock.lock();
+                if (--busy == 0 && ready.empty()) wake.notify_all();
+                continue;
+            }
+            if (busy == 0) {
+                if (timers.empty()) {
+                    finished = true;
+                    wake.notify_all();
+                    break;
+                }
+                // Все простаивают - переводим часы на ближайший таймер.
+                // По настенным часам сначала дожидаемся его срока, и только
+                // потом отдаём корутины в ready, чтобы другие потоки не
+                // разбудили их раньше времени
+                auto due = timers.begin();
+                if (mode == ClockMode::RealTime) {
+                    auto deadline = start + tickPeriod * static_cast<int64_t>(due->first);
+                    ++busy;   // пока спим, другие потоки часы не трогают
+                    lock.unlock();
+                    std::this_thread::sleep_until(deadline);
+                    lock.lock();
+                    --busy;
+                    due = timers.begin();   // пока спали, мог появиться таймер раньше
+                }
+                tick = due->first;
+                for (auto h : due->second) ready.push_back(h);
+                timers.erase(due);
+                wake.notify_all();
+                continue;
+            }
+            wake.wait(lock);
+        }
+    }
+
+public:
+    CoroutineExecutor(ClockMode mode, std::chrono::nanoseconds tickPeriod)
+        : mode(mode), tickPeriod(tickPeriod) {}
+
+    void schedule(std::coroutine_handle<> h) {
         {
-            std::lock_guard<std::mutex> lock(battleMutex);
-            hero.displayInfo();
-            monster.displayInfo();
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(h);
         }
+        wake.notify_one();
+    }
+
+    void scheduleAfter(uint64_t ticks, std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> lock(mutex);
+        timers[tick + ticks].push_back(h);
+    }
+
+    // Исполняет корутины, пока все не завершатся или не уснут навсегда
+    void run(unsigned workers = 0) {
+        if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+        start = std::chrono::steady_clock::now();
+        finished = false;
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < workers; ++t) pool.emplace_back(&CoroutineExecutor::workerLoop, this);
+        workerLoop();
+        for (auto& th : pool) th.join();
+    }
+
+    uint64_t currentTick() const { return tick; }
+    uint64_t resumeCount() const { return resumes; }
+
+    std::chrono::nanoseconds simulatedTime() const {
+        return tickPeriod * static_cast<int64_t>(tick);
+    }
+
+    // co_await executor.delay(n) - проснуться через n тиков
+    auto delay(uint64_t ticks) {
+        struct DelayAwaiter {
+            CoroutineExecutor& executor;
+            uint64_t ticks;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor.scheduleAfter(ticks, h); }
+            void await_resume() const noexcept {}
+        };
+        return DelayAwaiter{*this, ticks};
+    }
+
+    // co_await executor.nextTick() - дождаться следующего тика
+    auto nextTick() {
+        return delay(1);
+    }
+};
+
+// Сигнал "противник сделал ход": один ожидающий, один сигналящий.
+// Состояние: пусто, сигнал уже пришёл, или адрес ждущей корутины.
+class OpponentAction {
+private:
+    static constexpr uintptr_t kSignaled = 1;
+    std::atomic<uintptr_t> state{0};
+    CoroutineExecutor* executor;
+
+public:
+    explicit OpponentAction(CoroutineExecutor& executor) : executor(&executor) {}
+
+    void notify() {
+        uintptr_t prev = state.exchange(kSignaled, std::memory_order_acq_rel);
+        if (prev != 0 && prev != kSignaled) {
+            state.store(0, std::memory_order_relaxed);
+            executor->schedule(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(prev)));
+        }
+    }
+
+    bool await_ready() noexcept {
+        uintptr_t expected = kSignaled;
+        return state.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        uintptr_t expected = 0;
+        if (state.compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(h.address()), std::memory_order_acq_rel))
+            return true;
+        // Сигнал пришёл между await_ready и await_suspend - продолжаем сразу
+        state.store(0, std::memory_order_relaxed);
+        return false;
     }
 
-    // Завершение боя
-    if (hero.isAlive()) {
-        std::cout << hero.name << " wins the battle!\n";
-    } else {
-        std::cout << monster.name << " wins the battle!\n";
+    void await_resume() const noexcept {}
+};
+
+// Бой двух актёров: герой бьёт на каждом тике, монстр отвечает на его удар
+struct ActorDuel {
+    Battle battle;
+    OpponentAction heroActed;
+    OpponentAction monsterActed;
+    int heroDamage = 0;
+
+    ActorDuel(const Battle& b, CoroutineExecutor& executor)
+        : battle(b), heroActed(executor), monsterActed(executor) {}
+};
+
+BattleTask heroActor(ActorDuel& duel, CoroutineExecutor& executor, uint64_t startDelay) {
+    co_await executor.delay(startDelay);
+    while (!duel.battle.isFinished()) {
+        duel.heroDamage = duel.battle.heroStrike();
+        duel.heroActed.notify();
+        co_await duel.monsterActed;
+        if (!duel.battle.isFinished()) co_await executor.nextTick();
     }
 }
 
-int main() {
-    // Запуск потока для боя
-    std::thread battleThread(battle);
+BattleTask monsterActor(ActorDuel& duel) {
+    while (true) {
+        co_await duel.heroActed;
+        int damageToHero = duel.battle.monsterStrike();
+        duel.battle.report(duel.heroDamage, damageToHero);
+        bool finished = duel.battle.isFinished();
+        duel.monsterActed.notify();
+        if (finished) co_return;
+    }
+}
+
+// 100k боёв-корутин на пуле потоков и сравнение цены переключения с моделью
+// "поток на бой", где бойцы передают ход друг другу через condition_variable
+// (lab7.2 --bench-coroutines)
+void runCoroutineBattles(size_t count, size_t threadBattles) {
+    CoroutineExecutor executor(ClockMode::TimeWarp, std::chrono::seconds(1));
+    std::deque<ActorDuel> duels;   // адреса дуэлей не должны меняться: на них ссылаются корутины
+    std::vector<BattleTask> tasks;
+    tasks.reserve(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+        int hp = 100 + static_cast<int>(i % 200);
+        duels.emplace_back(Battle(Character("Hero", 300, 15, 10), Monster("Goblin", hp, 11, 10)), executor);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        tasks.push_back(heroActor(duels[i], executor, i % 10));
+        tasks.push_back(monsterActor(duels[i]));
+        executor.schedule(tasks[tasks.size() - 2].get());
+        executor.schedule(tasks.back().get());
+    }
+    size_t frames = BattleTask::promise_type::frameBytes.load();
+    size_t perBattle = (frames + count * sizeof(ActorDuel)) / count;
+
+    auto start = std::chrono::steady_clock::now();
+    executor.run();
+    double coroutineSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t done = std::count_if(tasks.begin(), tasks.end(), [](const BattleTask& t) { return t.done(); });
+
+    std::cout << "Coroutines: " << count << " battles, " << perBattle << " bytes per suspended battle, "
+              << executor.currentTick() << " ticks, " << done << "/" << tasks.size() << " actors done, "
+              << coroutineSec * 1e9 / static_cast<double>(executor.resumeCount()) << " ns per switch" << std::endl;
 
-    // Ожидаем завершения потока боя
-    battleThread.join();
+    // Та же пара актёров на потоках: каждый ход - пробуждение другого потока
+    struct ThreadDuel {
+        Battle battle;
+        std::mutex m;
+        std::condition_variable cv;
+        bool heroTurn = true;
+        explicit ThreadDuel(const Battle& b) : battle(b) {}
+    };
+    std::vector<std::unique_ptr<ThreadDuel>> threadDuels;
+    for (size_t i = 0; i < threadBattles; ++i) {
+        threadDuels.push_back(std::make_unique<ThreadDuel>(Battle(Character("Hero", 300, 11, 10), Monster("Goblin", 200, 11, 10))));
+    }
+    std::atomic<uint64_t> switches{0};
+    auto actor = [&switches](ThreadDuel& d, bool isHero) {
+        std::unique_lock<std::mutex> lock(d.m);
+        while (true) {
+            d.cv.wait(lock, [&] { return d.heroTurn == isHero || d.battle.isFinished(); });
+            if (d.battle.isFinished()) break;
+            if (isHero) d.battle.heroStrike();
+            else d.battle.monsterStrike();
+            d.heroTurn = !isHero;
+            switches.fetch_add(1, std::memory_order_relaxed);
+            d.cv.notify_one();
+        }
+        d.cv.notify_one();
+    };
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (auto& d : threadDuels) {
+        threads.emplace_back(actor, std::ref(*d), true);
+        threads.emplace_back(actor, std::ref(*d), false);
+    }
+    for (auto& th : threads) th.join();
+    double threadSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Threads: " << threadBattles << " battles on " << threads.size() << " threads, "
+              << threadSec * 1e9 / static_cast<double>(switches.load()) << " ns per switch" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Тысячи боёв на общем пуле потоков в ускоренном режиме
+    if (argc > 1 && std::string(argv[1]) == "--bench-timewarp") {
+        runTimeWarpBattles(2000);
+        return 0;
+    }
+    // Бои-корутины и сравнение с моделью "поток на бой"
+    if (argc > 1 && std::string(argv[1]) == "--bench-coroutines") {
+        runCoroutineBattles(100000, 200);
+        return 0;
+    }
+    // Проверка пакетного ядра урона на массовой битве
+    if (argc > 1 && std::string(argv[1]) == "--bench-hits") {
+        verifyHitKernel(1 << 22);
+        return 0;
+    }
+
+    // Бой героя с гоблином в реальном времени: один раунд в секунду
+    {
+        CombatLog console(std::cout);
+        Battle battle(Character("Hero", 100, 20, 10), Monster("Goblin", 80, 15, 5), &console);
+        TickScheduler realTime(ClockMode::RealTime, std::chrono::seconds(1), 1);
+        realTime.add(battle);
+        realTime.run();
+    }
 
     return 0;
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <cstring>
+
+// Буферизованный вывод: текст копится в заранее выделенном буфере,
+// числа пишутся через std::to_chars, а в поток всё уходит одной записью
+// при flush() (или когда буфер заполнился). Сбрасывать сам поток - дело
+// вызывающего, как и при обычном operator<<.
+class OutputSink {
+private:
+    std::ostream* target;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    void reserve(size_t n) {
+        if (used + n > buffer.size()) {
+            flush();
+            if (n > buffer.size()) buffer.resize(n);
+        }
+    }
+
+public:
+    explicit OutputSink(std::ostream& target = std::cout, size_t capacity = 1 << 16)
+        : target(&target), buffer(capacity) {}
+
+    ~OutputSink() {
+        flush();
+    }
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    OutputSink& operator<<(std::string_view text) {
+        reserve(text.size());
+        std::memcpy(buffer.data() + used, text.data(), text.size());
+        used += text.size();
+        return *this;
+    }
+
+    OutputSink& operator<<(const char* text) { return *this << std::string_view(text); }
+    OutputSink& operator<<(const std::string& text) { return *this << std::string_view(text); }
+
+    OutputSink& operator<<(char c) {
+        reserve(1);
+        buffer[used++] = c;
+        return *this;
+    }
+
+    OutputSink& operator<<(int value) {
+        reserve(16);
+        auto result = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+        used = static_cast<size_t>(result.ptr - buffer.data());
+        return *this;
+    }
+
+    // Одна запись на всю накопленную пачку
+    void flush() {
+        if (used == 0) return;
+        target->write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+    }
+
+    // Дописывает накопленное в прежний поток и переключается на другой
+    void retarget(std::ostream& stream) {
+        flush();
+        target = &stream;
+    }
+};
+
+// Общий буфер консоли: displayInfo и подобные методы пишут в него и
+// сбрасывают в конце, не выделяя память на каждый вызов
+inline OutputSink& consoleSink() {
+    static OutputSink sink(std::cout);
+    return sink;
+}
+
+// Любой тип с render(OutputSink&) выводится в буфер через <<
+template<typename T>
+auto operator<<(OutputSink& out, const T& value) -> decltype(value.render(out), out) {
+    value.render(out);
+    return out;
+}
+
+// Вывод в обычный поток через тот же render(): формат описан один раз.
+// Буфер у потока выполнения свой и переиспользуется между вызовами.
+template<typename T>
+std::ostream& renderTo(std::ostream& os, const T& value) {
+    thread_local OutputSink scratch(os, 256);
+    scratch.retarget(os);
+    value.render(scratch);
+    scratch.flush();
+    return os;
+}